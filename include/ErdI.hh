@@ -0,0 +1,295 @@
+/*========================================================================
+  Copyright (c) 2025 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+#pragma once
+
+#include <iostream>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <gmp.h>
+#include "gmpxx.h"
+
+#include "Erd.hh"
+#include "Erdd.hh"
+
+/*
+  Interval of extended-range doubles, [lo, hi], with outward rounding.
+  Each endpoint operation is computed with round-to-nearest,
+  and an error-free transformation determines whether the
+  endpoint must be moved outward by one ulp.
+  This leaves the FPU rounding mode untouched.
+ */
+typedef struct {
+    erd_t lo;
+    erd_t hi;
+} erdi_t;
+
+/********************* Directed ERD operations **********************/
+
+/* Move one ulp up or down */
+static erd_t erd_step(erd_t a, bool up) {
+    erd_t nval;
+    nval.dbl = nextafter(a.dbl, up ? INFINITY : -INFINITY);
+    nval.exp = a.exp;
+    return erd_normalize(nval);
+}
+
+/* Adjust rounded result dval, having exact error err, in direction up or down */
+static double dbl_direct(double dval, double err, bool up) {
+    if (up ? err > 0 : err < 0)
+	return nextafter(dval, up ? INFINITY : -INFINITY);
+    return dval;
+}
+
+/* Sum rounded toward +infinity (up) or -infinity (!up) */
+static erd_t erd_add_directed(erd_t a, erd_t b, bool up) {
+    if (erd_is_zero(a))
+	return b;
+    if (erd_is_zero(b))
+	return a;
+    if (a.exp > b.exp + DBL_MAX_PREC)
+	return (b.dbl > 0) == up ? erd_step(a, up) : a;
+    if (b.exp > a.exp + DBL_MAX_PREC)
+	return (a.dbl > 0) == up ? erd_step(b, up) : b;
+    erd_t nval;
+    int64_t ediff = a.exp - b.exp;
+#if ERD_LIBRARY
+    double ad = ldexp(a.dbl, ediff);
+#else
+    double ad = dbl_replace_exponent(a.dbl, ediff);
+#endif
+    double err;
+    double sum = dd_two_sum(ad, b.dbl, &err);
+    nval.dbl = dbl_direct(sum, err, up);
+    nval.exp = b.exp;
+    return erd_normalize(nval);
+}
+
+/* Product rounded toward +infinity (up) or -infinity (!up) */
+static erd_t erd_mul_directed(erd_t a, erd_t b, bool up) {
+    if (erd_is_zero(a) || erd_is_zero(b))
+	return erd_zero();
+    erd_t nval;
+    double err;
+    double prod = dd_two_prod(a.dbl, b.dbl, &err);
+    nval.dbl = dbl_direct(prod, err, up);
+    nval.exp = a.exp + b.exp;
+    return erd_normalize(nval);
+}
+
+/* Is a < b?  Sign of rounded difference is always correct */
+static bool erd_less(erd_t a, erd_t b) {
+    return erd_add(a, erd_negate(b)).dbl < 0;
+}
+
+/********************* ERDI *************************/
+
+static erdi_t erdi_from_erd(erd_t a) {
+    erdi_t nval;
+    nval.lo = a;
+    nval.hi = a;
+    return nval;
+}
+
+static erdi_t erdi_from_double(double dval) {
+    return erdi_from_erd(erd_from_double(dval));
+}
+
+/* Get exact value of endpoint */
+static void erd_to_mpq(mpq_ptr dest, erd_t a) {
+    mpq_set_d(dest, a.dbl);
+    if (a.exp > 0)
+	mpq_mul_2exp(dest, dest, a.exp);
+    else if (a.exp < 0)
+	mpq_div_2exp(dest, dest, -a.exp);
+}
+
+/* Tightest enclosing interval, with endpoints widened until they bound the rational */
+static erdi_t erdi_from_mpq(mpq_srcptr qval) {
+    mpf_t mval;
+    mpf_init2(mval, 128);
+    mpf_set_q(mval, qval);
+    erdi_t nval = erdi_from_erd(erd_from_mpf(mval));
+    mpf_clear(mval);
+    mpq_t eq;
+    mpq_init(eq);
+    erd_to_mpq(eq, nval.lo);
+    while (mpq_cmp(eq, qval) > 0) {
+	nval.lo = erd_step(nval.lo, false);
+	erd_to_mpq(eq, nval.lo);
+    }
+    erd_to_mpq(eq, nval.hi);
+    while (mpq_cmp(eq, qval) < 0) {
+	nval.hi = erd_step(nval.hi, true);
+	erd_to_mpq(eq, nval.hi);
+    }
+    mpq_clear(eq);
+    return nval;
+}
+
+static bool erdi_is_zero(erdi_t a) {
+    return erd_is_zero(a.lo) && erd_is_zero(a.hi);
+}
+
+static bool erdi_is_nonnegative(erdi_t a) {
+    return a.lo.dbl >= 0;
+}
+
+static erdi_t erdi_negate(erdi_t a) {
+    erdi_t nval;
+    nval.lo = erd_negate(a.hi);
+    nval.hi = erd_negate(a.lo);
+    return nval;
+}
+
+static erdi_t erdi_add(erdi_t a, erdi_t b) {
+    erdi_t nval;
+    nval.lo = erd_add_directed(a.lo, b.lo, false);
+    nval.hi = erd_add_directed(a.hi, b.hi, true);
+    return nval;
+}
+
+static erdi_t erdi_mul(erdi_t a, erdi_t b) {
+    erdi_t nval;
+    if (erdi_is_nonnegative(a) && erdi_is_nonnegative(b)) {
+	nval.lo = erd_mul_directed(a.lo, b.lo, false);
+	nval.hi = erd_mul_directed(a.hi, b.hi, true);
+	return nval;
+    }
+    erd_t ends[2][2] = { { a.lo, a.hi }, { b.lo, b.hi } };
+    nval.lo = erd_mul_directed(a.lo, b.lo, false);
+    nval.hi = erd_mul_directed(a.lo, b.lo, true);
+    for (int i = 0; i < 2; i++)
+	for (int j = 0; j < 2; j++) {
+	    if (i == 0 && j == 0)
+		continue;
+	    erd_t lo = erd_mul_directed(ends[0][i], ends[1][j], false);
+	    erd_t hi = erd_mul_directed(ends[0][i], ends[1][j], true);
+	    if (erd_less(lo, nval.lo))
+		nval.lo = lo;
+	    if (erd_less(nval.hi, hi))
+		nval.hi = hi;
+	}
+    return nval;
+}
+
+static erd_t erdi_mid(erdi_t a) {
+    erd_t sum = erd_add(a.lo, a.hi);
+    if (erd_is_zero(sum))
+	return sum;
+    sum.exp -= 1;
+    return sum;
+}
+
+/* Log2 of smallest magnitude in interval.  -infinity if interval contains zero */
+static double erdi_log2_mig(erdi_t a) {
+    if (a.lo.dbl <= 0 && a.hi.dbl >= 0)
+	return -INFINITY;
+    erd_t m = a.lo.dbl > 0 ? a.lo : erd_negate(a.hi);
+    return erd_log2d(m);
+}
+
+/* Log2 of largest magnitude in interval.  -infinity if interval is zero */
+static double erdi_log2_mag(erdi_t a) {
+    erd_t l = a.lo.dbl < 0 ? erd_negate(a.lo) : a.lo;
+    erd_t h = a.hi.dbl < 0 ? erd_negate(a.hi) : a.hi;
+    erd_t m = erd_less(l, h) ? h : l;
+    if (erd_is_zero(m))
+	return -INFINITY;
+    return erd_log2d(m);
+}
+
+/* Number of digits guaranteed by relative width, up to max_precision */
+static double erdi_digit_precision(erdi_t a, double max_precision) {
+    if (erdi_is_zero(a))
+	return max_precision;
+    if (a.lo.dbl <= 0 && a.hi.dbl >= 0)
+	return 0.0;
+    erd_t diam = erd_add(a.hi, erd_negate(a.lo));
+    if (erd_is_zero(diam))
+	return max_precision;
+    erd_t mid = erdi_mid(a);
+    if (mid.dbl < 0)
+	mid = erd_negate(mid);
+    double result = -erd_log10d(erd_div(diam, mid));
+    if (result < 0)
+	result = 0.0;
+    if (result > max_precision)
+	result = max_precision;
+    return result;
+}
+
+class ErdI {
+private:
+    erdi_t eval;
+
+    ErdI(erdi_t val) { eval = val; }
+
+public:
+
+    ErdI() { eval = erdi_from_double(0.0); }
+
+    ErdI(double d) { eval = erdi_from_double(d); }
+
+    ErdI(int i) { eval = erdi_from_double((double) i); }
+
+    ErdI(mpq_srcptr qval) { eval = erdi_from_mpq(qval); }
+
+    bool is_zero() { return erdi_is_zero(eval); }
+
+    /* Midpoint */
+    void get_mpf(mpf_ptr dest) { erd_to_mpf(dest, erdi_mid(eval)); }
+    mpf_class get_mpf() { mpf_class val(0.0, 64); erd_to_mpf(val.get_mpf_t(), erdi_mid(eval)); return val; }
+
+    void get_lower_mpf(mpf_ptr dest) { erd_to_mpf(dest, eval.lo); }
+    void get_upper_mpf(mpf_ptr dest) { erd_to_mpf(dest, eval.hi); }
+
+    double digit_precision(double max_precision) { return erdi_digit_precision(eval, max_precision); }
+
+    double log2_mig() { return erdi_log2_mig(eval); }
+    double log2_mag() { return erdi_log2_mag(eval); }
+
+    ErdI& operator=(const ErdI &v) { eval = v.eval; return *this; }
+    ErdI& operator=(const double v) { eval = erdi_from_double(v); return *this; }
+    ErdI& operator=(const int v)  { eval = erdi_from_double((double) v); return *this; }
+
+    ErdI operator+(const ErdI &other) const { return ErdI(erdi_add(eval, other.eval)); }
+    ErdI operator*(const ErdI &other) const { return ErdI(erdi_mul(eval, other.eval)); }
+    ErdI operator-() const { return ErdI(erdi_negate(eval)); }
+    ErdI operator-(const ErdI &other) const { return ErdI(erdi_add(eval, erdi_negate(other.eval))); }
+    ErdI& operator*=(const ErdI &other) { eval = erdi_mul(eval, other.eval); return *this; }
+    ErdI& operator+=(const ErdI &other) { eval = erdi_add(eval, other.eval); return *this; }
+
+    friend std::ostream& operator<<(std::ostream& os, const ErdI &a) {
+	char buf[ERD_BUF];
+	erd_string(a.eval.lo, buf, ERD_NSIG);
+	os << "[" << (const char *) buf << ", ";
+	erd_string(a.eval.hi, buf, ERD_NSIG);
+	os << (const char *) buf << "]";
+	return os;
+    }
+
+};
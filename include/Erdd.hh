@@ -0,0 +1,320 @@
+/*========================================================================
+  Copyright (c) 2025 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+#pragma once
+
+#include <iostream>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <gmp.h>
+#include "gmpxx.h"
+
+#include "Erd.hh"
+
+/*
+  Representation of floating-point numbers based on double-double,
+  with additional exponent field to support extended range.
+  Value = (hi + lo) * 2^exp, with |lo| <= ulp(hi)/2
+ */
+typedef struct {
+    double hi;
+    double lo;
+    int64_t exp;
+} erdd_t;
+
+/********************* Defines **********************/ 
+
+/* Mantissa bits in double-double representation, plus one */
+#define DD_MAX_PREC 107
+
+/* Number of bits of precision that can be guaranteed for each operation */
+#define ERDD_PRECISION 100
+
+/* MPF precision used when converting to and from MPF */
+#define ERDD_MPF_PREC 128
+
+/********************* Double-double *************************/
+
+/* Power of 2 as double.  Requires -1022 <= k <= 1023 */
+static double dd_pow2(int64_t k) {
+    union {
+	double   d;
+	uint64_t b;
+    } u;
+    u.b = (uint64_t) (k + DBL_BIAS) << DBL_EXP_OFFSET;
+    return u.d;
+}
+
+/* Error-free transformations */
+static double dd_two_sum(double a, double b, double *err) {
+    double s = a + b;
+    double bb = s - a;
+    *err = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+/* Requires |a| >= |b| */
+static double dd_quick_two_sum(double a, double b, double *err) {
+    double s = a + b;
+    *err = b - (s - a);
+    return s;
+}
+
+static double dd_two_prod(double a, double b, double *err) {
+    double p = a * b;
+    *err = fma(a, b, -p);
+    return p;
+}
+
+/********************* ERDD *************************/
+
+static bool erdd_is_zero(erdd_t a) {
+    return a.hi == 0.0;
+}
+
+static erdd_t erdd_zero() {
+    erdd_t nval;
+    nval.hi = 0.0;
+    nval.lo = 0.0;
+    nval.exp = 0;
+    return nval;
+}
+
+/* Scale so that 1 <= |hi| < 2 */
+static erdd_t erdd_normalize(erdd_t a) {
+    if (erdd_is_zero(a))
+	return erdd_zero();
+    int64_t dexp = dbl_get_exponent(a.hi);
+    double scale = dd_pow2(-dexp);
+    erdd_t nval;
+    nval.hi = a.hi * scale;
+    nval.lo = a.lo * scale;
+    nval.exp = a.exp + dexp;
+    return nval;
+}
+
+static erdd_t erdd_from_double(double dval) {
+    erdd_t nval;
+    nval.hi = dval;
+    nval.lo = 0.0;
+    nval.exp = 0;
+    return erdd_normalize(nval);
+}
+
+/* Get both halves of mantissa.  Source should have at least 106 bits of precision */
+static erdd_t erdd_from_mpf(mpf_srcptr fval) {
+    if (mpf_sgn(fval) == 0)
+	return erdd_zero();
+    long int exp;
+    mpf_get_d_2exp(&exp, fval);
+    mpf_t rem;
+    mpf_init2(rem, mpf_get_prec(fval));
+    if (exp < 0)
+	mpf_mul_2exp(rem, fval, -exp);
+    else
+	mpf_div_2exp(rem, fval, exp);
+    erdd_t nval;
+    nval.hi = mpf_get_d(rem);
+    mpf_t dhi;
+    mpf_init2(dhi, 64);
+    mpf_set_d(dhi, nval.hi);
+    mpf_sub(rem, rem, dhi);
+    nval.lo = mpf_get_d(rem);
+    nval.exp = (int64_t) exp;
+    mpf_clear(dhi);
+    mpf_clear(rem);
+    double err;
+    nval.hi = dd_quick_two_sum(nval.hi, nval.lo, &err);
+    nval.lo = err;
+    return erdd_normalize(nval);
+}
+
+static void erdd_to_mpf(mpf_ptr dest, erdd_t eval) {
+    mpf_set_d(dest, eval.hi);
+    if (erdd_is_zero(eval))
+	return;
+    mpf_t dlo;
+    mpf_init2(dlo, 64);
+    mpf_set_d(dlo, eval.lo);
+    mpf_add(dest, dest, dlo);
+    mpf_clear(dlo);
+    if (eval.exp < 0)
+	mpf_div_2exp(dest, dest, -eval.exp);
+    else if (eval.exp > 0)
+	mpf_mul_2exp(dest, dest, eval.exp);
+}
+
+static erd_t erdd_to_erd(erdd_t eval) {
+    erd_t nval;
+    nval.dbl = eval.hi + eval.lo;
+    nval.exp = eval.exp;
+    return erd_normalize(nval);
+}
+
+static bool erdd_is_equal(erdd_t a, erdd_t b) {
+    if (erdd_is_zero(a))
+	return erdd_is_zero(b);
+    return a.hi == b.hi && a.lo == b.lo && a.exp == b.exp;
+}
+
+static erdd_t erdd_negate(erdd_t a) {
+    if (erdd_is_zero(a))
+	return a;
+    erdd_t nval;
+    nval.hi = -a.hi;
+    nval.lo = -a.lo;
+    nval.exp = a.exp;
+    return nval;
+}
+
+static erdd_t erdd_add(erdd_t a, erdd_t b) {
+    if (erdd_is_zero(a))
+	return b;
+    if (erdd_is_zero(b))
+	return a;
+    if (a.exp > b.exp + DD_MAX_PREC)
+	return a;
+    if (b.exp > a.exp + DD_MAX_PREC)
+	return b;
+    // Align to larger exponent.  Scaling is exact
+    erdd_t nval;
+    double bhi = b.hi, blo = b.lo;
+    double ahi = a.hi, alo = a.lo;
+    if (a.exp >= b.exp) {
+	double scale = dd_pow2(b.exp - a.exp);
+	bhi *= scale;
+	blo *= scale;
+	nval.exp = a.exp;
+    } else {
+	double scale = dd_pow2(a.exp - b.exp);
+	ahi *= scale;
+	alo *= scale;
+	nval.exp = b.exp;
+    }
+    double e, f;
+    double s = dd_two_sum(ahi, bhi, &e);
+    double t = dd_two_sum(alo, blo, &f);
+    e += t;
+    s = dd_quick_two_sum(s, e, &e);
+    e += f;
+    nval.hi = dd_quick_two_sum(s, e, &nval.lo);
+    return erdd_normalize(nval);
+}
+
+static erdd_t erdd_quick_mul(erdd_t a, erdd_t b) {
+    erdd_t nval;
+    double e;
+    double p = dd_two_prod(a.hi, b.hi, &e);
+    e += a.hi * b.lo + a.lo * b.hi;
+    nval.hi = dd_quick_two_sum(p, e, &nval.lo);
+    nval.exp = a.exp + b.exp;
+    return nval;
+}
+
+static erdd_t erdd_mul(erdd_t a, erdd_t b) {
+    return erdd_normalize(erdd_quick_mul(a, b));
+}
+
+static int erdd_cmp(erdd_t a, erdd_t b) {
+    if (erdd_is_equal(a, b))
+	return 0;
+    erdd_t diff = erdd_add(a, erdd_negate(b));
+    if (erdd_is_zero(diff))
+	return 0;
+    return diff.hi < 0 ? -1 : 1;
+}
+
+class Erdd {
+private:
+    erdd_t eval;
+
+    Erdd(erdd_t val) { eval = val; }
+
+    erdd_t& get_erdd_t() { return eval; }
+
+public:
+
+    Erdd() { eval = erdd_zero(); }
+
+    Erdd(double d) { eval = erdd_from_double(d); }
+
+    Erdd(int i) { eval = erdd_from_double((double) i); }
+
+    Erdd(mpf_srcptr mval) { eval = erdd_from_mpf(mval); }
+
+    bool is_zero() { return erdd_is_zero(eval); }
+
+    void get_mpf(mpf_ptr dest) { return erdd_to_mpf(dest, eval); }
+    mpf_class get_mpf() { mpf_class val(0.0, ERDD_MPF_PREC); erdd_to_mpf(val.get_mpf_t(), eval); return val; }
+
+    double get_double() { return erd_to_double(erdd_to_erd(eval)); }
+
+    Erdd add(const Erdd &other) const { return Erdd(erdd_add(eval, other.eval)); }
+
+    Erdd mul(const Erdd &other) const { return Erdd(erdd_mul(eval, other.eval)); }
+
+    Erdd& operator=(const Erdd &v) { eval = v.eval; return *this; }
+    Erdd& operator=(const mpf_t v) { eval = erdd_from_mpf(v); return *this; }
+    Erdd& operator=(const double v) { eval = erdd_from_double(v); return *this; }
+    Erdd& operator=(const int v)  { eval = erdd_from_double((double) v); return *this; }
+
+    bool operator==(const Erdd &other) const { return erdd_is_equal(eval, other.eval); }
+    bool operator!=(const Erdd &other) const { return !erdd_is_equal(eval, other.eval); }
+    Erdd operator+(const Erdd &other) const { return Erdd(erdd_add(eval, other.eval)); }
+    Erdd operator*(const Erdd &other) const { return Erdd(erdd_mul(eval, other.eval)); }
+    Erdd operator-() const { return Erdd(erdd_negate(eval)); }
+    Erdd operator-(const Erdd &other) const { return Erdd(erdd_add(eval, erdd_negate(other.eval))); }
+    Erdd& operator*=(const Erdd &other) { eval = erdd_mul(eval, other.eval); return *this; }
+    Erdd& operator+=(const Erdd &other) { eval = erdd_add(eval, other.eval); return *this; }
+    bool operator<(const Erdd &other) const { return erdd_cmp(eval, other.eval) < 0; }
+    bool operator<=(const Erdd &other) const { return erdd_cmp(eval, other.eval) <= 0; }
+    bool operator>(const Erdd &other) const { return erdd_cmp(eval, other.eval) > 0; }
+    bool operator>=(const Erdd &other) const { return erdd_cmp(eval, other.eval) >= 0; }
+
+    friend Erdd product_reduce(Erdd *data, int len) {
+	erdd_t prod = erdd_from_double(1.0);
+	int rcount = 0;
+	for (int i = 0; i < len; i++) {
+	    prod = erdd_quick_mul(prod, data[i].get_erdd_t());
+	    if (++rcount >= MAX_MUL) {
+		prod = erdd_normalize(prod);
+		rcount = 0;
+	    }
+	}
+	return Erdd(erdd_normalize(prod));
+    }
+
+    friend Erdd product_reduce(std::vector<Erdd> data) { return product_reduce(data.data(), (int) data.size()); }
+
+    friend std::ostream& operator<<(std::ostream& os, const Erdd &a) {
+	char buf[ERD_BUF];
+	erd_string(erdd_to_erd(a.eval), buf, ERD_NSIG);
+	os << (const char *) buf;
+	return os;
+    }
+
+};
@@ -0,0 +1,57 @@
+/*========================================================================
+  Copyright (c) 2023 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+/* Error analysis of different implementations of rational/real arithmetic */
+
+#pragma once
+
+#include "q25.h"
+
+
+/* Allow this headerfile to define C++ constructs if requested */
+#ifdef __cplusplus
+#define CPLUSPLUS
+#endif
+
+#ifdef CPLUSPLUS
+extern "C" {
+#endif
+
+/* Upper threshold for digit precision metric */
+#define MAX_DIGIT_PRECISION (1000*1000)
+
+/* Returns number between 0 and MAX_DIGIT_PRECISION */
+double digit_precision_q25(q25_ptr x_est, q25_ptr x);
+
+double digit_precision_mix(q25_ptr x_est, double x);
+
+double digit_precision(double x_est, double x);
+
+double digit_precision_mpf(mpf_srcptr x_est, mpf_srcptr x);
+
+
+#ifdef CPLUSPLUS
+}
+#endif
@@ -26,6 +26,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -354,6 +355,41 @@ static erd_t erd_add(erd_t a, erd_t b) {
     return erd_normalize(nval);
 }
 
+/* Error-free addition.  Returns rounded sum and sets err to the rounding error */
+static erd_t erd_two_sum(erd_t a, erd_t b, erd_t *err) {
+    *err = erd_zero();
+#if ERDZ
+    if (erd_is_zero(a))
+	return b;
+    if (erd_is_zero(b))
+	return a;
+#endif
+    if (a.exp > b.exp + DBL_MAX_PREC) {
+	*err = b;
+	return a;
+    }
+    if (b.exp > a.exp + DBL_MAX_PREC) {
+	*err = a;
+	return b;
+    }
+    int64_t ediff = a.exp - b.exp;
+#if ERD_LIBRARY
+    double ad = ldexp(a.dbl, ediff);
+#else
+    double ad = dbl_replace_exponent(a.dbl, ediff);
+#endif
+    double s = ad + b.dbl;
+    double bb = s - ad;
+    erd_t nerr;
+    nerr.dbl = (ad - (s - bb)) + (b.dbl - bb);
+    nerr.exp = b.exp;
+    *err = erd_normalize(nerr);
+    erd_t nval;
+    nval.dbl = s;
+    nval.exp = b.exp;
+    return erd_normalize(nval);
+}
+
 static erd_t erd_quick_mul(erd_t a, erd_t b) {
     erd_t nval;
     nval.exp = a.exp + b.exp;
@@ -535,7 +571,7 @@ static void erd_string(erd_t a, char *buf, int nsig) {
     // Get integer part of exponent
     long long dec = (long long) floor(dlog);
     // Incorporate the fractional part of the exponent into da
-    da *= __exp10(dlog-floor(dlog));
+    da *= pow(10.0, dlog-floor(dlog));
     // Get decimal exponent for da
     long long dexp = (long long) floor(log10(da));
     // Add to decimal exponent
@@ -603,6 +639,14 @@ public:
 
     Erd mul(const Erd &other) const { return Erd(erd_mul(eval, other.eval)); }
 
+    // Compensated addition.  Rounding error is accumulated in error
+    Erd& add_compensated(const Erd &other, Erd &error) {
+	erd_t err;
+	eval = erd_two_sum(eval, other.eval, &err);
+	error.eval = erd_add(error.eval, err);
+	return *this;
+    }
+
     Erd log2() const { return erd_log2(eval); }
 
     Erd log10() const { return erd_log10(eval); }
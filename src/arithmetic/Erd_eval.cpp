@@ -9,6 +9,7 @@
 
 #include "report.h"
 #include "Erd.hh"
+#include "Erld.hh"
 
 /*********** Useful functions ***********/
 const char *mpf_string(mpf_class &val, int digits) {
@@ -55,6 +56,12 @@ const char *erd_mpf_string(Erd a) {
     return mpf_string(mval, 20);
 }
 
+const char *erld_mpf_string(Erld a) {
+    mpf_class mval(0.0, 64);
+    mval = a.get_mpf();
+    return mpf_string(mval, 20);
+}
+
 static double dbl_sum_seq_x4(double *val, int len) {
     // Assume that len >= 4
     int i, j;
@@ -123,6 +130,21 @@ double run_sum_erd(Erd &result, double *dval, int len, int reps) {
     return t;
 }
 
+/* Time and run summations  */
+double run_sum_erld(Erld &result, double *dval, int len, int reps) {
+    std::vector<Erld> eval;
+    eval.resize(len);
+    for (int i = 0; i < len; i++)
+	eval[i] = dval[i];
+    double t = tod();
+    result = 0.0;
+    for (int r = 0; r < reps; r++)
+	for (int i = 0; i < len; i++)
+	    result += eval[i];
+    t = tod() - t;
+    return t;
+}
+
 
 static double dbl_prod_seq_x4(double *val, int len) {
     // Assume that len >= 4
@@ -193,6 +215,21 @@ double run_prod_erd(Erd &result, double *dval, int len, int reps) {
     return t;
 }
 
+/* Time and run products  */
+double run_prod_erld(Erld &result, double *dval, int len, int reps) {
+    std::vector<Erld> eval;
+    eval.resize(len);
+    for (int i = 0; i < len; i++) 
+	eval[i] = dval[i];
+
+    double t = tod();
+    result = 1.0;
+    for (int r = 0; r < reps; r++) 
+	result *= product_reduce(eval);
+    t = tod() - t;
+    return t;
+}
+
 double uniform_value(double min, double max, double zpct) {
     double z = (double) random() / (double) ((1L<<31)-1);
     if (z * 100 < zpct)
@@ -257,8 +294,11 @@ void run_sum(char *prefix, double *data, int len, int reps) {
     double dt = run_sum_dbl(&dval, data, len, reps);
     double mt = run_sum_mpf(mval, data, len, reps);
     double et = run_sum_erd(eval, data, len, reps);
+    Erld lval;
+    double lt = run_sum_erld(lval, data, len, reps);
     const char *ms = mpf_string(mval, 20);
     const char *es = erd_mpf_string(eval);
+    const char *ls = erld_mpf_string(lval);
     Erd log10 = eval.log10();
     mpf_class md(0, 64);
     double dpd;
@@ -270,6 +310,8 @@ void run_sum(char *prefix, double *data, int len, int reps) {
     }
     mpf_class me = eval.get_mpf();
     double dpe = digit_precision(me, mval);
+    mpf_class ml = lval.get_mpf();
+    double dpl = digit_precision(ml, mval);
     long sums = (long) len * reps;
     report(1, "%s: Len = %d reps = %d sums = %ld\n",
 	   prefix, len, reps, sums);
@@ -277,11 +319,15 @@ void run_sum(char *prefix, double *data, int len, int reps) {
 	   dval, dt * 1e12 / sums, dpd);
     report(1, "    ERD: Sum = %s ps/sum = %.2f precision = %.2f\n",
 	   es, et * 1e12 / sums, dpe);
+    report(1, "    ERLD: Sum = %s ps/sum = %.2f precision = %.2f\n",
+	   ls, lt * 1e12 / sums, dpl);
     std::cout << "c     Cout Sum = " << eval << " log10 = " << log10 << std::endl;
     report(1, "    MPF: Sum = %s ps/sum = %.2f\n",
 	   ms, mt * 1e12 / sums);
     report(1, "    MPF:DBL = %f  MPF:ERD = %f ERD:DBL = %f\n",
 	   mt/dt, mt/et, et/dt);
+    report(1, "    MPF:ERLD = %f  ERLD:ERD = %f\n",
+	   mt/lt, lt/et);
 }
 
 void run_prod(char *prefix, double *data, int len, int reps) {
@@ -291,9 +337,12 @@ void run_prod(char *prefix, double *data, int len, int reps) {
     double dt = run_prod_dbl(&dval, data, len, reps);
     double mt = run_prod_mpf(mval, data, len, reps);
     double et = run_prod_erd(eval, data, len, reps);
-    report(1, "Times: DBL %f MPF %f ERD %f\n", dt, mt, et);
+    Erld lval;
+    double lt = run_prod_erld(lval, data, len, reps);
+    report(1, "Times: DBL %f MPF %f ERD %f ERLD %f\n", dt, mt, et, lt);
     const char *ms = mpf_string(mval, 20);
     const char *es = erd_mpf_string(eval);
+    const char *ls = erld_mpf_string(lval);
     Erd log10 = eval.log10();
     mpf_class md(0, 64);
     double dpd;
@@ -305,6 +354,8 @@ void run_prod(char *prefix, double *data, int len, int reps) {
     }
     mpf_class me = eval.get_mpf();
     double dpe = digit_precision(me, mval);
+    mpf_class ml = lval.get_mpf();
+    double dpl = digit_precision(ml, mval);
     long prods = (long) len * reps;
     report(1, "%s: Len = %d reps = %d prods = %ld\n",
 	   prefix, len, reps, prods);
@@ -312,11 +363,15 @@ void run_prod(char *prefix, double *data, int len, int reps) {
 	   dval, dt * 1e12 / prods, dpd);
     report(1, "    ERD: Product = %s ps/prod = %.2f precision = %.2f\n",
 	   es, et * 1e12 / prods, dpe);
+    report(1, "    ERLD: Product = %s ps/prod = %.2f precision = %.2f\n",
+	   ls, lt * 1e12 / prods, dpl);
     std::cout << "c     Cout Product = " << eval << " log10 = " << log10 << std::endl;
     report(1, "    MPF: Product = %s ps/prod = %.2f\n",
 	   ms, mt * 1e12 / prods);
     report(1, "    MPF:DBL = %f  MPF:ERD = %f ERD:DBL = %f\n",
 	   mt/dt, mt/et, et/dt);
+    report(1, "    MPF:ERLD = %f  ERLD:ERD = %f\n",
+	   mt/lt, lt/et);
 }
 
 
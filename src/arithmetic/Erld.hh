@@ -0,0 +1,355 @@
+/*========================================================================
+  Copyright (c) 2025 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+#pragma once
+
+#include <iostream>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <gmp.h>
+#include "gmpxx.h"
+
+#include "Erd.hh"
+
+/*
+  Representation of floating-point numbers based on long double,
+  with additional exponent field to support extended range.
+  On x86, long double is the x87 80-bit format with a 64-bit mantissa
+ */
+typedef struct {
+    long double ld;
+    int64_t exp;
+} erld_t;
+
+/********************* Defines **********************/ 
+
+/* Mantissa bits in long double, plus one */
+#define LDBL_MAX_PREC (LDBL_MANT_DIG+1)
+
+/* Number of bits of precision that can be guaranteed for each operation */
+#define ERLD_PRECISION (LDBL_MANT_DIG-1)
+
+/* MPF precision used when converting to and from MPF */
+#define ERLD_MPF_PREC 128
+
+/* 
+   Use bit manipulation on x87 extended format.
+   Otherwise, use library functions frexpl and ldexpl
+*/
+#if defined(__x86_64__) || defined(__i386__)
+#define ERLD_X87 (LDBL_MANT_DIG == 64)
+#else
+#define ERLD_X87 0
+#endif
+
+/********************* Long double **********************/
+
+#if ERLD_X87
+
+#define LDBL_EXP_MASK ((uint16_t) 0x7fff)
+#define LDBL_BIAS ((int64_t) 0x3fff)
+
+/* Power of 2 as double.  Requires -1022 <= k <= 1023 */
+static double dd_pow2_ld(int64_t k) {
+    union {
+	double   d;
+	uint64_t b;
+    } u;
+    u.b = (uint64_t) (k + DBL_BIAS) << DBL_EXP_OFFSET;
+    return u.d;
+}
+
+typedef union {
+    long double ld;
+    struct {
+	uint64_t mant;
+	uint16_t sexp;
+    } b;
+} ldbl_bits_t;
+
+/* Get exponent as signed integer */
+static int64_t ldbl_get_exponent(long double x) {
+    ldbl_bits_t u;
+    u.ld = x;
+    return (int64_t) (u.b.sexp & LDBL_EXP_MASK) - LDBL_BIAS;
+}
+
+/* 
+   Scale by power of 2.  Multiplying by double avoids partial writes to the
+   80-bit representation, which stall store forwarding
+*/
+static long double ldbl_scale(long double x, int64_t k) {
+    if (k < -1022 || k > 1023)
+	return ldexpl(x, (int) k);
+    return x * dd_pow2_ld(k);
+}
+
+#endif
+
+/********************* ERLD *************************/
+
+static bool erld_is_zero(erld_t a) {
+    return a.ld == 0.0L;
+}
+
+static erld_t erld_zero() {
+    erld_t nval;
+    nval.ld = 0.0L;
+    nval.exp = 0;
+    return nval;
+}
+
+/* Scale so that 1 <= |ld| < 2 */
+static erld_t erld_normalize(erld_t a) {
+    if (erld_is_zero(a))
+	return erld_zero();
+    erld_t nval;
+#if ERLD_X87
+    int64_t dexp = ldbl_get_exponent(a.ld);
+    nval.exp = a.exp + dexp;
+    nval.ld = ldbl_scale(a.ld, -dexp);
+#else
+    int dexp;
+    nval.ld = 2.0L * frexpl(a.ld, &dexp);
+    nval.exp = a.exp + dexp - 1;
+#endif
+    return nval;
+}
+
+static erld_t erld_from_double(double dval) {
+    erld_t nval;
+    nval.ld = (long double) dval;
+    nval.exp = 0;
+    return erld_normalize(nval);
+}
+
+/* Get full long double mantissa.  Source should have at least LDBL_MANT_DIG bits of precision */
+static erld_t erld_from_mpf(mpf_srcptr fval) {
+    if (mpf_sgn(fval) == 0)
+	return erld_zero();
+    long int exp;
+    mpf_get_d_2exp(&exp, fval);
+    mpf_t rem;
+    mpf_init2(rem, mpf_get_prec(fval));
+    if (exp < 0)
+	mpf_mul_2exp(rem, fval, -exp);
+    else
+	mpf_div_2exp(rem, fval, exp);
+    double hi = mpf_get_d(rem);
+    mpf_t dhi;
+    mpf_init2(dhi, 64);
+    mpf_set_d(dhi, hi);
+    mpf_sub(rem, rem, dhi);
+    double lo = mpf_get_d(rem);
+    mpf_clear(dhi);
+    mpf_clear(rem);
+    erld_t nval;
+    nval.ld = (long double) hi + (long double) lo;
+    nval.exp = (int64_t) exp;
+    return erld_normalize(nval);
+}
+
+static void erld_to_mpf(mpf_ptr dest, erld_t eval) {
+    double hi = (double) eval.ld;
+    double lo = (double) (eval.ld - (long double) hi);
+    mpf_set_d(dest, hi);
+    if (erld_is_zero(eval))
+	return;
+    mpf_t dlo;
+    mpf_init2(dlo, 64);
+    mpf_set_d(dlo, lo);
+    mpf_add(dest, dest, dlo);
+    mpf_clear(dlo);
+    if (eval.exp < 0)
+	mpf_div_2exp(dest, dest, -eval.exp);
+    else if (eval.exp > 0)
+	mpf_mul_2exp(dest, dest, eval.exp);
+}
+
+static erd_t erld_to_erd(erld_t eval) {
+    erd_t nval;
+    nval.dbl = (double) eval.ld;
+    nval.exp = eval.exp;
+    return erd_normalize(nval);
+}
+
+static bool erld_is_equal(erld_t a, erld_t b) {
+    if (erld_is_zero(a))
+	return erld_is_zero(b);
+    return a.ld == b.ld && a.exp == b.exp;
+}
+
+static erld_t erld_negate(erld_t a) {
+    if (erld_is_zero(a))
+	return a;
+    erld_t nval;
+    nval.ld = -a.ld;
+    nval.exp = a.exp;
+    return nval;
+}
+
+static erld_t erld_add(erld_t a, erld_t b) {
+    if (erld_is_zero(a))
+	return b;
+    if (erld_is_zero(b))
+	return a;
+    if (a.exp > b.exp + LDBL_MAX_PREC)
+	return a;
+    if (b.exp > a.exp + LDBL_MAX_PREC)
+	return b;
+    erld_t nval;
+    int64_t ediff = a.exp - b.exp;
+#if ERLD_X87
+    long double ad = ldbl_scale(a.ld, ediff);
+#else
+    long double ad = ldexpl(a.ld, (int) ediff);
+#endif
+    nval.ld = ad + b.ld;
+    nval.exp = b.exp;
+    return erld_normalize(nval);
+}
+
+static erld_t erld_quick_mul(erld_t a, erld_t b) {
+    erld_t nval;
+    nval.exp = a.exp + b.exp;
+    nval.ld = a.ld * b.ld;
+    return nval;
+}
+
+static erld_t erld_mul(erld_t a, erld_t b) {
+    return erld_normalize(erld_quick_mul(a, b));
+}
+
+static int erld_cmp(erld_t a, erld_t b) {
+    if (erld_is_equal(a, b))
+	return 0;
+    erld_t diff = erld_add(a, erld_negate(b));
+    if (erld_is_zero(diff))
+	return 0;
+    return diff.ld < 0 ? -1 : 1;
+}
+
+class Erld {
+private:
+    erld_t eval;
+
+    Erld(erld_t val) { eval = val; }
+
+    erld_t& get_erld_t() { return eval; }
+
+public:
+
+    Erld() { eval = erld_zero(); }
+
+    Erld(double d) { eval = erld_from_double(d); }
+
+    Erld(int i) { eval = erld_from_double((double) i); }
+
+    Erld(mpf_srcptr mval) { eval = erld_from_mpf(mval); }
+
+    bool is_zero() { return erld_is_zero(eval); }
+
+    void get_mpf(mpf_ptr dest) { return erld_to_mpf(dest, eval); }
+    mpf_class get_mpf() { mpf_class val(0.0, ERLD_MPF_PREC); erld_to_mpf(val.get_mpf_t(), eval); return val; }
+
+    double get_double() { return erd_to_double(erld_to_erd(eval)); }
+
+    Erld add(const Erld &other) const { return Erld(erld_add(eval, other.eval)); }
+
+    Erld mul(const Erld &other) const { return Erld(erld_mul(eval, other.eval)); }
+
+    Erld& operator=(const Erld &v) { eval = v.eval; return *this; }
+    Erld& operator=(const mpf_t v) { eval = erld_from_mpf(v); return *this; }
+    Erld& operator=(const double v) { eval = erld_from_double(v); return *this; }
+    Erld& operator=(const int v)  { eval = erld_from_double((double) v); return *this; }
+
+    bool operator==(const Erld &other) const { return erld_is_equal(eval, other.eval); }
+    bool operator!=(const Erld &other) const { return !erld_is_equal(eval, other.eval); }
+    Erld operator+(const Erld &other) const { return Erld(erld_add(eval, other.eval)); }
+    Erld operator*(const Erld &other) const { return Erld(erld_mul(eval, other.eval)); }
+    Erld operator-() const { return Erld(erld_negate(eval)); }
+    Erld operator-(const Erld &other) const { return Erld(erld_add(eval, erld_negate(other.eval))); }
+    Erld& operator*=(const Erld &other) { eval = erld_mul(eval, other.eval); return *this; }
+    Erld& operator+=(const Erld &other) { eval = erld_add(eval, other.eval); return *this; }
+    bool operator<(const Erld &other) const { return erld_cmp(eval, other.eval) < 0; }
+    bool operator<=(const Erld &other) const { return erld_cmp(eval, other.eval) <= 0; }
+    bool operator>(const Erld &other) const { return erld_cmp(eval, other.eval) > 0; }
+    bool operator>=(const Erld &other) const { return erld_cmp(eval, other.eval) >= 0; }
+
+    friend Erld product_reduce_x4(Erld *data, int len) {
+	// Assume len >= 4
+	erld_t prod[4];
+	int i, j;
+	for (j = 0; j < 4; j++) 
+	    prod[j] = data[j].get_erld_t();
+	int count = 0;
+	for (i = 4; i <= len-4; i+= 4) {
+	    for (j = 0; j < 4; j++)
+		prod[j] = erld_quick_mul(prod[j], data[i+j].get_erld_t());
+	    if (++count > MAX_MUL) {
+		count = 0;
+		for (j = 0; j < 4; j++)
+		    prod[j] = erld_normalize(prod[j]);
+	    }
+	}
+	if (count * 4 > MAX_MUL) {
+	    for (j = 0; j < 4; j++)
+		prod[j] = erld_normalize(prod[j]);
+	}
+	erld_t result = prod[0];
+	for (j = 1; j < 4; j++)
+	    result = erld_quick_mul(result, prod[j]);
+	for (; i < len; i++)
+	    result = erld_quick_mul(result, data[i].get_erld_t());
+	return Erld(erld_normalize(result));
+    }
+
+    friend Erld product_reduce(Erld *data, int len) {
+	if (len >= 8)
+	    return product_reduce_x4(data, len);
+	erld_t prod = erld_from_double(1.0);
+	int rcount = 0;
+	for (int i = 0; i < len; i++) {
+	    prod = erld_quick_mul(prod, data[i].get_erld_t());
+	    if (++rcount >= MAX_MUL) {
+		prod = erld_normalize(prod);
+		rcount = 0;
+	    }
+	}
+	return Erld(erld_normalize(prod));
+    }
+
+    friend Erld product_reduce(std::vector<Erld> data) { return product_reduce(data.data(), (int) data.size()); }
+
+    friend std::ostream& operator<<(std::ostream& os, const Erld &a) {
+	char buf[ERD_BUF];
+	erd_string(erld_to_erd(a.eval), buf, ERD_NSIG);
+	os << (const char *) buf;
+	return os;
+    }
+
+};
@@ -26,33 +26,92 @@
 
 #include <limits.h>
 #include <stdbool.h>
+#include <pthread.h>
 #include "counters.h"
 #include "report.h"
 
-typedef struct {
-    int min;
-    int max;
-    int count;
-    long total;
-} histo_info_t;
+static counter_set_t global_set;
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
 
-static long int counters[COUNT_NUM];
-static double timers[TIME_NUM];
-static histo_info_t histograms[HISTO_NUM];
+// Set used by the current thread.  NULL indicates the global set
+static __thread counter_set_t *thread_set = NULL;
 
 static bool initialized = false;
 
+static void clear_histo(histo_info_t *h) {
+    h->min = INT_MAX;
+    h->max = INT_MIN;
+    h->count = 0;
+    h->total = 0;
+}
+
+void init_counter_set(counter_set_t *set) {
+    for (int c = 0; c < COUNT_NUM; c++)
+	set->counters[c] = 0;
+    for (int t = 0; t < TIME_NUM; t++)
+	set->timers[t] = 0.0;
+    for (int h = 0; h < HISTO_NUM; h++)
+	clear_histo(&set->histograms[h]);
+}
+
 static void test_init() {
     if (initialized)
 	return;
+    pthread_mutex_lock(&global_lock);
+    if (!initialized)
+	init_counter_set(&global_set);
+    initialized = true;
+    pthread_mutex_unlock(&global_lock);
+}
+
+void merge_counter_set(counter_set_t *dest, counter_set_t *src) {
     for (int c = 0; c < COUNT_NUM; c++)
-	counters[c] = 0;
+	dest->counters[c] += src->counters[c];
     for (int t = 0; t < TIME_NUM; t++)
-	timers[t] = 0.0;
+	dest->timers[t] += src->timers[t];
     for (int h = 0; h < HISTO_NUM; h++) {
-	reset_histo(h);
+	histo_info_t *dh = &dest->histograms[h];
+	histo_info_t *sh = &src->histograms[h];
+	if (sh->min < dh->min)
+	    dh->min = sh->min;
+	if (sh->max > dh->max)
+	    dh->max = sh->max;
+	dh->count += sh->count;
+	dh->total += sh->total;
     }
-    initialized = true;
+}
+
+static counter_set_t *current_set() {
+    return thread_set ? thread_set : &global_set;
+}
+
+void set_thread_counters(counter_set_t *set) {
+    thread_set = set;
+}
+
+counter_set_t *get_thread_counters() {
+    return thread_set;
+}
+
+void merge_thread_counters(counter_set_t *set) {
+    if (thread_set)
+	merge_counter_set(thread_set, set);
+    else
+	merge_global_counters(set);
+}
+
+void merge_global_counters(counter_set_t *set) {
+    test_init();
+    pthread_mutex_lock(&global_lock);
+    merge_counter_set(&global_set, set);
+    pthread_mutex_unlock(&global_lock);
+}
+
+void copy_global_counters(counter_set_t *dest) {
+    test_init();
+    pthread_mutex_lock(&global_lock);
+    *dest = global_set;
+    pthread_mutex_unlock(&global_lock);
 }
 
 static bool counter_ok(counter_t counter) {
@@ -66,7 +125,7 @@ static bool counter_ok(counter_t counter) {
 void incr_count_by(counter_t counter, int val) {
     if (!counter_ok(counter))
 	return;
-    counters[counter] += val;
+    current_set()->counters[counter] += val;
 }
 
 void incr_count(counter_t counter) {
@@ -76,21 +135,22 @@ void incr_count(counter_t counter) {
 void set_count(counter_t counter, int val) {
     if (!counter_ok(counter))
 	return;
-    counters[counter] = val;
+    current_set()->counters[counter] = val;
 }
 
 void max_count(counter_t counter, int val) {
     if (!counter_ok(counter))
 	return;
-    if (counters[counter] < val)
-	counters[counter] = val;
+    long int *c = &current_set()->counters[counter];
+    if (*c < val)
+	*c = val;
 }
 
 
 long get_long_count(counter_t counter) {
     if (!counter_ok(counter))
 	return -1;
-    return counters[counter];
+    return current_set()->counters[counter];
 
 }
 
@@ -107,19 +167,21 @@ static bool timer_ok(runtimer_t timer) {
 }
 
 void reset_timer(runtimer_t timer) {
-    timers[timer] = 0;
+    if (!timer_ok(timer))
+	return;
+    current_set()->timers[timer] = 0;
 }
 
 void incr_timer(runtimer_t timer, double secs) {
     if (!timer_ok(timer))
 	return;
-    timers[timer] += secs;
+    current_set()->timers[timer] += secs;
 }
 
 double get_timer(runtimer_t timer) {
     if (!timer_ok(timer))
 	return -1;
-    return timers[timer];
+    return current_set()->timers[timer];
 
 }
 
@@ -132,51 +194,52 @@ static bool histo_ok(histogram_t histo) {
 }
 
 void reset_histo(histogram_t histo) {
-    histograms[histo].min = INT_MAX;
-    histograms[histo].max = INT_MIN;
-    histograms[histo].count = 0;
-    histograms[histo].total = 0;
+    if (!histo_ok(histo))
+	return;
+    clear_histo(&current_set()->histograms[histo]);
 }
 
 void incr_histo(histogram_t histo, int datum) {
     if (!histo_ok(histo))
 	return;
-    histograms[histo].count++;
-    histograms[histo].total += datum;
-    if (datum < histograms[histo].min)
-	histograms[histo].min = datum;
-    if (datum > histograms[histo].max)
-	histograms[histo].max = datum;
+    histo_info_t *h = &current_set()->histograms[histo];
+    h->count++;
+    h->total += datum;
+    if (datum < h->min)
+	h->min = datum;
+    if (datum > h->max)
+	h->max = datum;
 }
 
 int get_histo_min(histogram_t histo) {
     if (!histo_ok(histo))
 	return INT_MAX;
-    return histograms[histo].min;
+    return current_set()->histograms[histo].min;
 }
 
 int get_histo_max(histogram_t histo) {
     if (!histo_ok(histo))
 	return INT_MAX;
-    return histograms[histo].max;
+    return current_set()->histograms[histo].max;
 }
 
 int get_histo_count(histogram_t histo) {
     if (!histo_ok(histo))
 	return INT_MAX;
-    return histograms[histo].count;
+    return current_set()->histograms[histo].count;
 }
 
 double get_histo_avg(histogram_t histo) {
     if (!histo_ok(histo))
 	return 0.0;
-    if (histograms[histo].count == 0)
+    histo_info_t *h = &current_set()->histograms[histo];
+    if (h->count == 0)
 	return 0;
-    return (double) histograms[histo].total / histograms[histo].count;
+    return (double) h->total / h->count;
 }
 
 long get_histo_total(histogram_t histo) {
     if (!histo_ok(histo))
 	return 0;
-    return histograms[histo].total;
+    return current_set()->histograms[histo].total;
 }
@@ -41,6 +41,21 @@ typedef enum { HISTO_SUMS, HISTO_NODE_PRODUCTS, HISTO_EDGE_PRODUCTS, HISTO_EDGE_
 
 typedef enum { TIME_SETUP, TIME_EVAL, TIME_NUM } runtimer_t;
 
+typedef struct {
+    int min;
+    int max;
+    int count;
+    long total;
+} histo_info_t;
+
+// Complete set of statistics.
+// Each thread records into its own set, which can then be merged into another
+typedef struct {
+    long int counters[COUNT_NUM];
+    double timers[TIME_NUM];
+    histo_info_t histograms[HISTO_NUM];
+} counter_set_t;
+
 
 /* Allow this headerfile to define C++ constructs if requested */
 #ifdef __cplusplus
@@ -51,6 +66,22 @@ typedef enum { TIME_SETUP, TIME_EVAL, TIME_NUM } runtimer_t;
 extern "C" {
 #endif
 
+// Clear all statistics in set
+void init_counter_set(counter_set_t *set);
+// Add statistics from src into dest.  Counters and timers are summed, histograms combined
+void merge_counter_set(counter_set_t *dest, counter_set_t *src);
+// Direct statistics of calling thread into set.  NULL restores the process-wide set
+void set_thread_counters(counter_set_t *set);
+// Set used by calling thread.  NULL indicates the process-wide set
+counter_set_t *get_thread_counters();
+// Merge set into the calling thread's set
+void merge_thread_counters(counter_set_t *set);
+// Merge set into the process-wide set.  Safe to call from multiple threads
+void merge_global_counters(counter_set_t *set);
+// Copy the process-wide set into dest
+void copy_global_counters(counter_set_t *dest);
+
+// Operations on the calling thread's set
 void incr_count(counter_t counter);
 void incr_count_by(counter_t counter, int val);
 void set_count(counter_t counter, int val);
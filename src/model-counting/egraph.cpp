@@ -31,6 +31,9 @@
 #include <cstring>
 #include <ctype.h>
 #include <math.h>
+#include <thread>
+#include <algorithm>
+#include <climits>
 
 #include "report.h"
 #include "counters.h"
@@ -48,7 +51,11 @@
   constant = 3 for smoothed evaluation and 5 for unsmoothed
 */
 double digit_precision_bound(int bit_precision, int nvar, double constant) {
-    return (double) bit_precision * log10(2) - log10(nvar * constant);
+    return digit_precision_bound(bit_precision, nvar * constant);
+}
+
+double digit_precision_bound(int bit_precision, double error_factor) {
+    return (double) bit_precision * log10(2) - log10(error_factor);
 }
 
 /*
@@ -56,14 +63,73 @@ double digit_precision_bound(int bit_precision, int nvar, double constant) {
   target digit precision when all weights are nonnegative?
   constant = 3 for smoothed evaluation and 5 for unsmoothed
  */
+double minimum_bit_precision(double target_precision, int nvar, double constant) {
+    return minimum_bit_precision(target_precision, nvar * constant);
+}
+
+double minimum_bit_precision(double target_precision, double error_factor) {
+    return target_precision * log2(10.0) + log2(error_factor);
+}
+
 int required_bit_precision(double target_precision, int nvar, double constant, bool nonnegative) {
-    double minp = target_precision * log2(10.0) + log2(nvar * constant);
+    return required_bit_precision(target_precision, nvar * constant, nonnegative);
+}
+
+int required_bit_precision(double target_precision, double error_factor, bool nonnegative) {
+    double minp = minimum_bit_precision(target_precision, error_factor);
     if (nonnegative && minp <= 52)
 	return 52;
     /* Must be multiple of 64 */
     return 64 * ceil(minp/64);
 }
 
+// Allow for higher-order terms when combining relative errors
+#define ROUNDING_SLACK 1.01
+
+/*
+  Each weight conversion and each operation contributes one unit of relative error.
+  Products accumulate the errors of their arguments, while sums of nonnegative
+  values take their maximum.  A sequential sum of n terms adds n-1 units.
+  A compensated sum adds one unit, plus a second-order term growing as n^2 * 2^-p.
+ */
+static double summation_error(int n, bool compensated) {
+    if (n <= 1)
+	return 0.0;
+    double sequential = n-1;
+    double compensated_error = 1.0 + (double) (n-1) * (n-1) * ldexp(1.0, -50);
+    return compensated && compensated_error < sequential ? compensated_error : sequential;
+}
+
+double rounding_error_bound(Egraph *egraph, Egraph_weights *weights, bool compensated) {
+    size_t ncount = egraph->operations.size();
+    // For products: accumulated error.  For sums: largest error of argument
+    std::vector<double> error(ncount, 0.0);
+    std::vector<int> fanin(ncount, 0);
+    for (Egraph_edge &e : egraph->edges) {
+	int from = e.from_id-1;
+	int to = e.to_id-1;
+	double ferror = error[from];
+	// Sum is complete once it is used
+	if (egraph->operations[from].type != NNF_AND)
+	    ferror += summation_error(fanin[from], compensated);
+	// Convert and multiply each weight, and then multiply by argument
+	double contribution = weights->disabled_edges[e.id-1] ? 0.0 :
+	    ferror + 2.0 * (e.literals.size() + e.smoothing_variables.size()) + 1;
+	if (fanin[to]++ == 0)
+	    error[to] = contribution;
+	else if (egraph->operations[to].type == NNF_AND)
+	    error[to] += contribution + 1;
+	else if (contribution > error[to])
+	    error[to] = contribution;
+    }
+    int root = egraph->root_id-1;
+    double root_error = error[root];
+    if (egraph->operations[root].type != NNF_AND)
+	root_error += summation_error(fanin[root], compensated);
+    root_error += 2.0 * weights->rescale_weights.size();
+    // Final conversion
+    return ROUNDING_SLACK * (root_error + 1);
+}
 
 const char *mpf_string(mpf_srcptr val, int digits) {
     char buf[2048];
@@ -106,7 +172,7 @@ const char *mpf_string(mpf_srcptr val, int digits) {
 
 const char *mpfr_string(mpfr_srcptr val, int digits) {
     mpf_t fval;
-    mpf_init(fval);
+    mpf_init2(fval, mpfr_get_prec(val));
     mpfr_get_f(fval, val, MPFR_RNDN);
     const char* result = mpf_string(fval, digits);
     mpf_clear(fval);
@@ -117,22 +183,21 @@ double digit_precision_mpfr(mpfr_srcptr x_est, mpq_srcptr x) {
     if (mpfr_cmp_q(x_est, x) == 0)
 	return (double) MAX_DIGIT_PRECISION;
 
-    mpfr_prec_t save_prec = mpfr_get_default_prec();
     mpfr_prec_t prec = 3*mpfr_get_prec(x_est);
-    mpfr_set_default_prec(prec);
 
     mpfr_t num;
     mpfr_t den;
+    mpfr_inits2(prec, num, den, NULL);
     if (mpq_sgn(x) == 0) {
-	mpfr_init_set_d(den, 1.0, MPFR_RNDN);
-	mpfr_init_set(num, x_est, MPFR_RNDN);
+	mpfr_set_d(den, 1.0, MPFR_RNDN);
+	mpfr_set(num, x_est, MPFR_RNDN);
 	mpfr_abs(num, num, MPFR_RNDN);
 	if (mpfr_cmp_d(num, 1.0) > 0)
 	    mpfr_set_d(num, 1.0, MPFR_RNDN);
     } else {
-	mpfr_init_set_q(den, x, MPFR_RNDN);
+	mpfr_set_q(den, x, MPFR_RNDN);
 	mpfr_abs(den, den, MPFR_RNDN);
-	mpfr_init_set_q(num, x, MPFR_RNDN);
+	mpfr_set_q(num, x, MPFR_RNDN);
 	mpfr_sub(num, num, x_est, MPFR_RNDN);
 	mpfr_abs(num, num, MPFR_RNDN);
     }
@@ -144,21 +209,23 @@ double digit_precision_mpfr(mpfr_srcptr x_est, mpq_srcptr x) {
     if (result > MAX_DIGIT_PRECISION)
 	result = MAX_DIGIT_PRECISION;
     mpfr_clears(num, den, NULL);
-    mpfr_set_default_prec(save_prec);
     return result;
 }
 
 double digit_precision_mpfi(mpfi_srcptr v) {
+    mpfr_prec_t prec = mpfi_get_prec(v);
     mpfr_t left;
-    mpfr_init(left);
+    mpfr_init2(left, prec);
     mpfr_t right;
-    mpfr_init(right);
+    mpfr_init2(right, prec);
     mpfi_get_left(left, v);
     mpfi_get_right(right, v);
-    if (mpfr_sgn(left) != mpfr_sgn(right))
+    bool straddles = mpfr_sgn(left) != mpfr_sgn(right);
+    mpfr_clears(left, right, NULL);
+    if (straddles)
 	return 0.0;
     mpfr_t diam;
-    mpfr_init(diam);
+    mpfr_init2(diam, prec);
     mpfi_diam_rel(diam, v);
     if (mpfr_sgn(diam) == 0) {
 	mpfr_clear(diam);
@@ -253,6 +320,18 @@ static void mpq_one_minus(mpq_ptr dest, mpq_srcptr val) {
     mpq_clear(one);
 }
 
+// Do two maps have the same set of keys?
+// Lets an evaluator overwrite its converted weights in place when rebinding
+template <class T, class U>
+static bool same_keys(const std::unordered_map<int,T> &a, const std::unordered_map<int,U> &b) {
+    if (a.size() != b.size())
+	return false;
+    for (auto &iter : b)
+	if (a.find(iter.first) == a.end())
+	    return false;
+    return true;
+}
+
 // Form product of values in queue.
 // Use breadth-first evaluation to form balanced binary tree
 static void reduce_product(mpq_class &product, std::vector<mpq_class> &eval_queue) {
@@ -281,17 +360,56 @@ static void reduce_product(mpq_class &product, std::vector<mpq_class> &eval_queu
 static const char *nnf_type_name[NNF_NUM] = { "NONE", "TRUE", "FALSE", "AND", "OR" };
 static const char nnf_type_char[NNF_NUM] = { '\0', 't', 'f', 'a', 'o' };
 
-// Current line number
-static int line_number = 0;
+void *Egraph_arena::allocate(size_t bytes) {
+    if (rounded(bytes) > limit - next)
+	throw std::bad_alloc();
+    void *p = (void *) next;
+    next += rounded(bytes);
+    return p;
+}
 
 Egraph::Egraph(std::unordered_set<int> *dvars, int nv) {
-    data_variables = dvars;
+    line_number = 0;
+    data_variables.assign(dvars->begin(), dvars->end());
+    sorted_data_variables = data_variables;
+    std::sort(sorted_data_variables.begin(), sorted_data_variables.end());
     is_smoothed = false;
     smooth_variable_count = 0;
-    disabled_edge_count = 0;
     nvar = nv;
 }
 
+Egraph::Egraph(const Egraph &graph, Egraph_arena *arena) :
+    operations(graph.operations.begin(), graph.operations.end(), Egraph_allocator<Egraph_operation>(arena)),
+    edges(Egraph_allocator<Egraph_edge>(arena)),
+    data_variables(graph.data_variables.begin(), graph.data_variables.end(), Egraph_allocator<int>(arena)),
+    sorted_data_variables(graph.sorted_data_variables.begin(), graph.sorted_data_variables.end(),
+			  Egraph_allocator<int>(arena)) {
+    edges.reserve(graph.edges.size());
+    for (const Egraph_edge &e : graph.edges) {
+	Egraph_edge ne = { e.id, e.from_id, e.to_id,
+			   egraph_vector<int>(e.literals.begin(), e.literals.end(), Egraph_allocator<int>(arena)),
+			   egraph_vector<int>(e.smoothing_variables.begin(), e.smoothing_variables.end(),
+					      Egraph_allocator<int>(arena)) };
+	edges.push_back(std::move(ne));
+    }
+    root_id = graph.root_id;
+    is_smoothed = graph.is_smoothed;
+    smooth_variable_count = graph.smooth_variable_count;
+    nvar = graph.nvar;
+    line_number = 0;
+}
+
+size_t Egraph::arena_bytes() const {
+    size_t bytes = Egraph_arena::rounded(sizeof(Egraph))
+	+ Egraph_arena::rounded(operations.size() * sizeof(Egraph_operation))
+	+ Egraph_arena::rounded(edges.size() * sizeof(Egraph_edge))
+	+ 2 * Egraph_arena::rounded(data_variables.size() * sizeof(int));
+    for (const Egraph_edge &e : edges)
+	bytes += Egraph_arena::rounded(e.literals.size() * sizeof(int))
+	    + Egraph_arena::rounded(e.smoothing_variables.size() * sizeof(int));
+    return bytes;
+}
+
 void Egraph::add_operation(int id, nnf_type_t type) {
     if (id > operations.size())
 	operations.resize(id);
@@ -318,6 +436,7 @@ void Egraph::add_operation(int id, nnf_type_t type) {
 int Egraph::add_edge(int from_id, int to_id) {
     size_t eid = edges.size()+1;
     edges.resize(eid);
+    edges[eid-1].id = eid;
     edges[eid-1].from_id = from_id;
     edges[eid-1].to_id = to_id;
     root_id = to_id;
@@ -540,7 +659,7 @@ void Egraph::smooth() {
     int id = edges.size();
     int child_id = edges[id-1].to_id;
     int scount = 0;
-    for (int v : *data_variables) {
+    for (int v : data_variables) {
 	if (operation_dependencies[child_id-1].find(v) == operation_dependencies[child_id-1].end()) {
 	    report(4, "Adding smoothing variable %d on root edge #%d (%d --> %d)\n", v, id, root_id, child_id);
 	    add_smoothing_variable(id, v);
@@ -553,29 +672,15 @@ void Egraph::smooth() {
     smooth_variable_count = smoothed_variables.size();
 }
 
-void Egraph::reset_smooth() {
-    if (is_smoothed || (smooth_variable_count == 0 && disabled_edge_count == 0))
-	return;
-    for (int id = 1; id <= edges.size(); id++) {
-	incr_count_by(COUNT_SMOOTH_VARIABLES, - (int) edges[id-1].smoothing_variables.size());
-	if (edges[id-1].smoothing_variables.size() != 0)
-	    report(4, "Removing %d variables from edge #%d (%d <-- %d)\n",
-		   (int) edges[id-1].smoothing_variables.size(), id, edges[id-1].to_id, edges[id-1].from_id);
-	edges[id-1].has_zero = false;
-	edges[id-1].smoothing_variables.clear();
-    }
-    reset_histo(HISTO_EDGE_SMOOTHS);
-    smooth_variable_count = 0;
-    disabled_edge_count = 0;
-}
-
-void Egraph::smooth_single(int var, bool is_zero) {
+int Egraph::disable_zero_variable(int var, std::vector<bool> &disabled_edges) const {
     int disable_count = 0;
+    // Graph not yet constructed
+    if (edges.size() == 0)
+	return 0;
     std::vector<bool> var_found;
     var_found.resize(operations.size(), false);
     std::vector<bool> edge_contains;
     edge_contains.resize(edges.size(), false);
-    int ecount = 0;
     for (int id = 1; id <= edges.size(); id++) {
 	int from_id = edges[id-1].from_id;
 	int to_id = edges[id-1].to_id;
@@ -599,57 +704,44 @@ void Egraph::smooth_single(int var, bool is_zero) {
 	    continue;
 	if (operations[to_id-1].type == NNF_AND)
 	    continue;
-	int scount = 0;
-	if (var_found[to_id-1] && !var_found[from_id-1] && !edge_contains[id-1]) {
-	    ecount++;
-	    if (is_zero) {
-		edges[id-1].has_zero = true;
-		disable_count++;
-		disabled_edge_count++;
-		report(4, "Disabling edge due to variable %d.  #%d (%d <-- %d)\n", var, id, to_id, from_id);
-	    } else {
-		add_smoothing_variable(id, var);
-		report(4, "Adding smoothing variable %d on edge #%d (%d <-- %d)\n", var, id, to_id, from_id);
-	    }
+	if (var_found[to_id-1] && !var_found[from_id-1] && !edge_contains[id-1] && !disabled_edges[id-1]) {
+	    disabled_edges[id-1] = true;
+	    disable_count++;
+	    report(4, "Disabling edge due to variable %d.  #%d (%d <-- %d)\n", var, id, to_id, from_id);
 	}
     }
     // Check at root
     int id = edges.size();
     int child_id = edges[id-1].to_id;
-    if (!var_found[child_id-1]) {
-	if (is_zero) {
-	    edges[id-1].has_zero = true;
-	    disable_count++;
-	    disabled_edge_count++;
-	    report(3, "Disabling root due to smoothing of variable %d\n", var);
-	} else {
-	    ecount++;
-	    add_smoothing_variable(id, var);
-	}
+    if (!var_found[child_id-1] && !disabled_edges[id-1]) {
+	disabled_edges[id-1] = true;
+	disable_count++;
+	report(3, "Disabling root due to smoothing of variable %d\n", var);
     }
     if (disable_count > 0)
 	report(3, "Disabled %d edges\n", disable_count);
-    if (ecount > 0) {
-	report(3, "Added smoothing variable %d to %d edges\n", var, ecount);
-	smooth_variable_count++;
-	incr_histo(HISTO_EDGE_SMOOTHS, 1);
-    } else 
-	report(3, "No copies of smoothing variable %d needed\n", var, ecount);
-
+    else 
+	report(3, "No edges disabled by zero-weight variable %d\n", var);
+    return disable_count;
 }
 
+std::recursive_mutex q25_lock;
+
 // literal_string_weights == NULL for unweighted
 Egraph_weights * Egraph::prepare_weights(std::unordered_map<int,const char*> *literal_string_weights) {
     Egraph_weights *weights = new(Egraph_weights);
-    reset_smooth();
     weights->all_nonnegative = true;
-    for (int v : *data_variables) {
+    weights->disabled_edges.assign(edges.size(), false);
+    weights->disabled_edge_count = 0;
+    weights->zero_variable_count = 0;
+    for (int v : data_variables) {
 	mpq_class pwt = 1;
 	bool gotp = false;
 	mpq_class nwt = 1;
 	bool gotn = false;
 
 	if (literal_string_weights) {
+	    std::lock_guard<std::recursive_mutex> guard(q25_lock);
 	    if (literal_string_weights->find(v) != literal_string_weights->end()) {
 		q25_ptr qpwt = q25_from_string((*literal_string_weights)[v]);
 		if (!q25_is_valid(qpwt)) {
@@ -693,7 +785,10 @@ Egraph_weights * Egraph::prepare_weights(std::unordered_map<int,const char*> *li
 	    weights->smoothing_weights[v] = sum;
 	else if (cmp(sum, mpq_class(0)) == 0) {
 	    weights->smoothing_weights[v] = sum;
-	    smooth_single(v, true);
+	    int dcount = disable_zero_variable(v, weights->disabled_edges);
+	    weights->disabled_edge_count += dcount;
+	    if (dcount > 0)
+		weights->zero_variable_count++;
 	} else if (cmp(sum, mpq_class(1)) != 0) {
 	    weights->rescale_weights.push_back(sum);
 	    pwt /= sum;
@@ -708,6 +803,118 @@ Egraph_weights * Egraph::prepare_weights(std::unordered_map<int,const char*> *li
 }
 
 
+/*******************************************************************************************************************
+Hashing of graphs and weights.  64-bit FNV-1a
+*******************************************************************************************************************/
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < len; i++) {
+	h ^= bytes[i];
+	h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static uint64_t hash_int(uint64_t h, int val) {
+    return hash_bytes(h, &val, sizeof(int));
+}
+
+static uint64_t hash_mpq(uint64_t h, const mpq_class &val) {
+    std::string s = val.get_str(16);
+    return hash_bytes(h, s.c_str(), s.size()+1);
+}
+
+uint64_t hash_graph(Egraph *egraph) {
+    uint64_t h = FNV_OFFSET;
+    h = hash_int(h, egraph->nvar);
+    h = hash_int(h, egraph->is_smoothed);
+    for (int v : egraph->sorted_data_variables)
+	h = hash_int(h, v);
+    for (Egraph_operation &op : egraph->operations)
+	h = hash_int(h, op.type);
+    for (Egraph_edge &e : egraph->edges) {
+	h = hash_int(h, e.from_id);
+	h = hash_int(h, e.to_id);
+	h = hash_int(h, e.literals.size());
+	for (int lit : e.literals)
+	    h = hash_int(h, lit);
+	h = hash_int(h, e.smoothing_variables.size());
+	for (int v : e.smoothing_variables)
+	    h = hash_int(h, v);
+    }
+    return hash_int(h, egraph->root_id);
+}
+
+uint64_t hash_string(const char *s) {
+    return hash_bytes(FNV_OFFSET, s, strlen(s));
+}
+
+uint64_t hash_weights(Egraph *egraph, Egraph_weights *weights) {
+    uint64_t h = FNV_OFFSET;
+    for (int v : egraph->sorted_data_variables) {
+	h = hash_int(h, v);
+	h = hash_mpq(h, weights->evaluation_weights[v]);
+	h = hash_mpq(h, weights->evaluation_weights[-v]);
+	auto fid = weights->smoothing_weights.find(v);
+	if (fid != weights->smoothing_weights.end())
+	    h = hash_mpq(h, fid->second);
+    }
+    // Rescaling is order independent
+    mpq_class rescale = 1;
+    for (mpq_class &r : weights->rescale_weights)
+	rescale *= r;
+    return hash_mpq(h, rescale);
+}
+
+/*******************************************************************************************************************
+Memory estimates
+*******************************************************************************************************************/
+
+size_t graph_bytes(Egraph *egraph) {
+    size_t bytes = sizeof(Egraph)
+	+ egraph->operations.capacity() * sizeof(Egraph_operation)
+	+ egraph->edges.capacity() * sizeof(Egraph_edge)
+	+ 2 * egraph->data_variables.capacity() * sizeof(int);
+    for (Egraph_edge &e : egraph->edges)
+	bytes += (e.literals.capacity() + e.smoothing_variables.capacity()) * sizeof(int);
+    return bytes;
+}
+
+static void max_weight_bits(const std::unordered_map<int,mpq_class> &wts, int key, size_t &nbits, size_t &dbits) {
+    auto fid = wts.find(key);
+    if (fid == wts.end())
+	return;
+    size_t n = mpz_sizeinbase(mpq_numref(fid->second.get_mpq_t()), 2);
+    size_t d = mpz_sizeinbase(mpq_denref(fid->second.get_mpq_t()), 2) - 1;
+    if (n > nbits)
+	nbits = n;
+    if (d > dbits)
+	dbits = d;
+}
+
+size_t predict_mpq_bytes(Egraph *egraph, Egraph_weights *weights) {
+    size_t num_bits = 0;
+    size_t den_bits = 0;
+    for (int v : egraph->data_variables) {
+	size_t nbits = 1;
+	size_t dbits = 0;
+	max_weight_bits(weights->evaluation_weights, v, nbits, dbits);
+	max_weight_bits(weights->evaluation_weights, -v, nbits, dbits);
+	max_weight_bits(weights->smoothing_weights, v, nbits, dbits);
+	// Sum of the literal weights is over common denominator and can carry
+	num_bits += nbits + dbits + 1;
+	den_bits += dbits;
+    }
+    size_t limb_bits = 8 * sizeof(mp_limb_t);
+    // Same accounting as for measured MPQ values
+    size_t size = 32 + ((num_bits + limb_bits - 1) / limb_bits + (den_bits + limb_bits - 1) / limb_bits) * sizeof(mp_limb_t);
+    return size + 8 * ((size + 7) / 8);
+}
+
 /*******************************************************************************************************************
 Evaluation via Q25
 *******************************************************************************************************************/
@@ -725,7 +932,7 @@ void Evaluator_q25::clear_evaluation() {
     for (auto iter : smoothing_weights)
 	q25_free(iter.second);
     smoothing_weights.clear();
-    egraph->reset_smooth();
+    disabled_edges.assign(egraph->edges.size(), false);
     q25_free(rescale);
     rescale = q25_from_32(1);
 
@@ -734,7 +941,7 @@ void Evaluator_q25::clear_evaluation() {
 // literal_string_weights == NULL for unweighted
 void Evaluator_q25::prepare_weights(std::unordered_map<int,const char*> *literal_string_weights) {
     clear_evaluation();
-    for (int v : *egraph->data_variables) {
+    for (int v : egraph->data_variables) {
 	q25_ptr pwt = NULL;
 	q25_ptr nwt = NULL;
 	if (!literal_string_weights) {
@@ -769,7 +976,7 @@ void Evaluator_q25::prepare_weights(std::unordered_map<int,const char*> *literal
 	    smoothing_weights[v] = sum;
 	else if (q25_is_zero(sum)) {
 	    smoothing_weights[v] = sum;
-	    egraph->smooth_single(v, true);
+	    egraph->disable_zero_variable(v, disabled_edges);
 
 	} else {
 	    int mark = q25_enter();
@@ -791,7 +998,7 @@ void Evaluator_q25::prepare_weights(std::unordered_map<int,const char*> *literal
 }
 
 q25_ptr Evaluator_q25::evaluate_edge(Egraph_edge &e) {
-    if (e.has_zero)
+    if (disabled_edges[e.id-1])
 	return q25_from_32(0);
     q25_ptr result = q25_from_32(1);
     int mark = q25_enter();
@@ -900,6 +1107,8 @@ double double_product_reduce(std::vector<double> &arguments) {
 
 Evaluator_double::Evaluator_double(Egraph *eg, Egraph_weights *wts) { 
     egraph = eg;
+    disabled_edges = wts->disabled_edges;
+    compensated = false;
     evaluation_weights.clear();
     for (auto iter : wts->evaluation_weights) {
 	int lit = iter.first;
@@ -925,7 +1134,7 @@ Evaluator_double::Evaluator_double(Egraph *eg, Egraph_weights *wts) {
     
 
 double Evaluator_double::evaluate_edge(Egraph_edge &e) {
-    if (e.has_zero)
+    if (disabled_edges[e.id-1])
 	return 0.0;
 #if PRODUCT_DIRECT
     double eval = 1.0;
@@ -963,13 +1172,28 @@ double Evaluator_double::evaluate() {
 	    operation_values[id-1] = 0.0;
 	}
     }
+    // Accumulated rounding errors for compensated summation
+    std::vector<double> compensation;
+    if (compensated)
+	compensation.resize(egraph->operations.size(), 0.0);
     for (Egraph_edge e : egraph->edges) {
+	if (compensated && compensation[e.from_id-1] != 0.0) {
+	    // Value is final once it is used
+	    operation_values[e.from_id-1] += compensation[e.from_id-1];
+	    compensation[e.from_id-1] = 0.0;
+	}
 	double edge_val = evaluate_edge(e);
 	double product = edge_val * operation_values[e.from_id-1];
 	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
-	double new_val = multiply ? 
-	    operation_values[e.to_id-1] * product:
-	    operation_values[e.to_id-1] + product;
+	double new_val;
+	if (multiply)
+	    new_val = operation_values[e.to_id-1] * product;
+	else if (compensated) {
+	    double err;
+	    new_val = dd_two_sum(operation_values[e.to_id-1], product, &err);
+	    compensation[e.to_id-1] += err;
+	} else
+	    new_val = operation_values[e.to_id-1] + product;
 	if (verblevel >= 4) {
 	    double dfrom = operation_values[e.from_id-1];
 	    double dold = operation_values[e.to_id-1];
@@ -980,6 +1204,8 @@ double Evaluator_double::evaluate() {
     }
 
     double result = operation_values[egraph->root_id-1];
+    if (compensated)
+	result += compensation[egraph->root_id-1];
     operation_values.clear();
     result *= rescale;
     report(4, "DBL: Result = %f\n", result);
@@ -995,21 +1221,28 @@ Evaluation via extended-range double
 Evaluator_erd::Evaluator_erd(Egraph *eg, Egraph_weights *wts) { 
     
     egraph = eg;
+    compensated = false;
+    operation_values.resize(egraph->operations.size());
+    rebind(wts);
+}
 
+void Evaluator_erd::rebind(Egraph_weights *wts) {
+    disabled_edges = wts->disabled_edges;
     mpf_t mval;
     mpf_init2(mval, 64);
 
-
-    /* Convert weight values from mpq to Erd */
-    evaluation_weights.clear();
-    for (auto iter : wts->evaluation_weights) {
+    /* Convert weight values from mpq to Erd.  Keep map entries when keys are unchanged */
+    if (!same_keys(evaluation_weights, wts->evaluation_weights))
+	evaluation_weights.clear();
+    for (auto &iter : wts->evaluation_weights) {
 	int lit = iter.first;
 	mpf_set_q(mval, iter.second.get_mpq_t());
 	evaluation_weights[lit] = Erd(mval);
     }
 
-    smoothing_weights.clear();
-    for (auto iter : wts->smoothing_weights) {
+    if (!same_keys(smoothing_weights, wts->smoothing_weights))
+	smoothing_weights.clear();
+    for (auto &iter : wts->smoothing_weights) {
 	int var = iter.first;
 	mpf_set_q(mval, iter.second.get_mpq_t());
 	smoothing_weights[var] = Erd(mval);
@@ -1017,22 +1250,23 @@ Evaluator_erd::Evaluator_erd(Egraph *eg, Egraph_weights *wts) {
 
 #if PRODUCT_DIRECT
     rescale = 1.0;
-    for (mpq_class qval : wts->rescale_weights) {
+    for (const mpq_class &qval : wts->rescale_weights) {
 	mpf_set_q(mval, qval.get_mpq_t());
 	rescale *= Erd(mval);
     }
 #else // PRODUCT_DIRECT
     std::vector<Erd> rescale_weights;
-    for (mpq_class qval : wts->rescale_weights) {
+    for (const mpq_class &qval : wts->rescale_weights) {
 	mpf_set_q(mval, qval.get_mpq_t());
 	rescale_weights.push_back(Erd(mval));
     }
     rescale = product_reduce(rescale_weights);
 #endif // PRODUCT_DIRECT
+    mpf_clear(mval);
 }
 
 Erd Evaluator_erd::evaluate_edge(Egraph_edge &e) {
-    if (e.has_zero)
+    if (disabled_edges[e.id-1])
 	return Erd();
 
 #if PRODUCT_DIRECT
@@ -1066,8 +1300,6 @@ Erd Evaluator_erd::evaluate_edge(Egraph_edge &e) {
 }
 
 void Evaluator_erd::evaluate(mpf_class &count) {
-    std::vector<Erd> operation_values;
-    operation_values.resize(egraph->operations.size());
     for (int id = 1; id <= egraph->operations.size(); id++) {
 	switch (egraph->operations[id-1].type) {
 	case NNF_TRUE:
@@ -1080,245 +1312,1406 @@ void Evaluator_erd::evaluate(mpf_class &count) {
 	    operation_values[id-1] = Erd(0.0);
 	}
     }
-    for (Egraph_edge e : egraph->edges) {
+    // Accumulated rounding errors for compensated summation
+    if (compensated)
+	compensation.assign(egraph->operations.size(), Erd());
+    for (Egraph_edge &e : egraph->edges) {
+	if (compensated && !compensation[e.from_id-1].is_zero()) {
+	    // Value is final once it is used
+	    operation_values[e.from_id-1] += compensation[e.from_id-1];
+	    compensation[e.from_id-1] = Erd();
+	}
 	Erd product = evaluate_edge(e) * operation_values[e.from_id-1];
 	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
 	if (multiply)
 	    operation_values[e.to_id-1] *= product;
+	else if (compensated)
+	    operation_values[e.to_id-1].add_compensated(product, compensation[e.to_id-1]);
 	else
 	    operation_values[e.to_id-1] += product;
     }
     Erd ecount = operation_values[egraph->root_id-1];
+    if (compensated)
+	ecount += compensation[egraph->root_id-1];
     ecount *= rescale;
     count = ecount.get_mpf();
 
 }
 
 /*******************************************************************************************************************
-Evaluation via Gnu multi-precision floating-point arithmetic
+Evaluation via extended-range double-double
 *******************************************************************************************************************/
 
-
-Evaluator_mpf::Evaluator_mpf(Egraph *eg, Egraph_weights *wts) { 
+Evaluator_erdd::Evaluator_erdd(Egraph *eg, Egraph_weights *wts) { 
     egraph = eg;
+    disabled_edges = wts->disabled_edges;
+
+    mpf_t mval;
+    mpf_init2(mval, ERDD_MPF_PREC);
 
-    /* Convert weight values from mpq to mpf */
+    /* Convert weight values from mpq to Erdd */
     evaluation_weights.clear();
     for (auto iter : wts->evaluation_weights) {
 	int lit = iter.first;
-	evaluation_weights[lit] = iter.second;
+	mpf_set_q(mval, iter.second.get_mpq_t());
+	evaluation_weights[lit] = Erdd(mval);
     }
 
     smoothing_weights.clear();
     for (auto iter : wts->smoothing_weights) {
 	int var = iter.first;
-	smoothing_weights[var] = iter.second;
+	mpf_set_q(mval, iter.second.get_mpq_t());
+	smoothing_weights[var] = Erdd(mval);
     }
 
     rescale = 1.0;
-    for (mpq_class qval : wts->rescale_weights)
-	rescale *= qval;
-
+    for (mpq_class qval : wts->rescale_weights) {
+	mpf_set_q(mval, qval.get_mpq_t());
+	rescale *= Erdd(mval);
+    }
+    mpf_clear(mval);
 }
 
-void Evaluator_mpf::evaluate_edge(mpf_class &value, Egraph_edge &e) {
-    if (e.has_zero) {
-	value = 0.0;
-	return;
-    }
-    value = 1;
-    for (int lit : e.literals)
-	value *= evaluation_weights[lit];
-    for (int v : e.smoothing_variables)
-	value *= smoothing_weights[v];
+Erdd Evaluator_erdd::evaluate_edge(Egraph_edge &e) {
+    if (disabled_edges[e.id-1])
+	return Erdd();
+
+    Erdd eval = 1.0;
+    for (int lit : e.literals) 
+	eval *= evaluation_weights[lit];
+    for (int v : e.smoothing_variables) 
+	eval *= smoothing_weights[v];
+
     if (verblevel >= 4) {
+	mpf_class mval = eval.get_mpf();
 	mp_exp_t exp;
-	char *svalue = mpf_get_str(NULL, &exp, 10, 40, value.get_mpf_t());
-	report(4, "MPF: Evaluating edge (%d <-- %d).  Value = 0.%se%ld\n", e.to_id, e.from_id, svalue, exp);
+	char *svalue = mpf_get_str(NULL, &exp, 10, 40, mval.get_mpf_t());
+	report(4, "ERDD: Evaluating edge (%d <-- %d).  Value = 0.%se%ld\n", e.to_id, e.from_id, svalue, exp);
 	free(svalue);
     }
+    return eval;
 }
 
-void Evaluator_mpf::evaluate(mpf_class &count) {
-
-    std::vector<mpf_class> operation_values;
+void Evaluator_erdd::evaluate(mpf_class &count) {
+    std::vector<Erdd> operation_values;
     operation_values.resize(egraph->operations.size());
     for (int id = 1; id <= egraph->operations.size(); id++) {
 	switch (egraph->operations[id-1].type) {
 	case NNF_TRUE:
 	case NNF_AND:
-	    operation_values[id-1] = 1;
+	    operation_values[id-1] = Erdd(1.0);
 	    break;
 	case NNF_FALSE:
 	case NNF_OR:
 	default:
-	    operation_values[id-1] = 0;
+	    operation_values[id-1] = Erdd(0.0);
 	}
     }
     for (Egraph_edge e : egraph->edges) {
-	char *sold = NULL;
-	char *sedge = NULL;
-	mp_exp_t eold, eedge, efrom, eproduct, enew_val;	
-	mpf_class product;
-
-	evaluate_edge(product, e);
-
-	if (verblevel >= 4) {
-	    sedge = mpf_get_str(NULL, &eedge, 10, 40, product.get_mpf_t());
-	    sold = mpf_get_str(NULL, &eold, 10, 40, operation_values[e.to_id-1].get_mpf_t());
-	}
-
-	product *= operation_values[e.from_id-1];
+	Erdd product = evaluate_edge(e) * operation_values[e.from_id-1];
 	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
 	if (multiply)
 	    operation_values[e.to_id-1] *= product;
 	else
 	    operation_values[e.to_id-1] += product;
-	if (verblevel >= 4) {
-	    char *sfrom = mpf_get_str(NULL, &efrom, 10, 40, operation_values[e.from_id-1].get_mpf_t());
-	    char *sproduct = mpf_get_str(NULL, &eproduct, 10, 40, product.get_mpf_t());
-	    char *snew_val = mpf_get_str(NULL, &enew_val, 10, 40, operation_values[e.to_id-1].get_mpf_t());
-	    report(4, "MPF: Density: Updating %d from %d.  0.%se%ld * 0.%se%ld %c 0.%se%ld --> 0.%se%ld\n",
-		   e.to_id, e.from_id, sfrom, efrom, sedge, eedge, multiply ? '*' : '+', sold, eold, snew_val, enew_val);
-	    free(sfrom); free(sold); free(sedge); free(sproduct); free(snew_val);
-	}
-    }
-    count = operation_values[egraph->root_id-1];
-
-    //    for (int id = 1; id <= egraph->operations.size(); id++)
-    //	mpf_clear(operation_values[id-1]);
-    operation_values.clear();
-
-    count *= rescale;
-
-    if (verblevel >= 4) {
-	mp_exp_t ecount;
-	char *scount = mpf_get_str(NULL, &ecount, 10, 40, count.get_mpf_t());
-	report(4, "MPF: Count = 0.%se%ld\n", scount, ecount);
-	free(scount);
     }
+    Erdd ecount = operation_values[egraph->root_id-1];
+    ecount *= rescale;
+    count = ecount.get_mpf();
 }
 
 /*******************************************************************************************************************
-Evaluation via Gnu multi-precision rational arithmetic
+Evaluation via extended-range long double
 *******************************************************************************************************************/
 
+Evaluator_erld::Evaluator_erld(Egraph *eg, Egraph_weights *wts) { 
+    egraph = eg;
+    disabled_edges = wts->disabled_edges;
 
-static size_t mpq_bytes(mpq_srcptr val) {
-    /* Overhead */
-    size_t size = 32;
-    mpz_t mp_num, mp_den;
-    mpz_init(mp_num); mpz_init(mp_den);
-    mpq_get_num(mp_num, val);
-    size += mpz_size(mp_num) * sizeof(mp_limb_t);
-    mpq_get_den(mp_den, val);
-    size += mpz_size(mp_den) * sizeof(mp_limb_t);
-    size += 8 * ceil(0.125 * size);
-    mpz_clear(mp_num); mpz_clear(mp_den);
-    return size;
-}
+    mpf_t mval;
+    mpf_init2(mval, ERLD_MPF_PREC);
 
-Evaluator_mpq::Evaluator_mpq(Egraph *eg, Egraph_weights *wts) { 
-    egraph = eg;
-    weights = wts;
-}
-    
-void Evaluator_mpq::clear_evaluation() {
-    rescale = 1;
-    max_bytes = 0;
-}
+    /* Convert weight values from mpq to Erld */
+    evaluation_weights.clear();
+    for (auto iter : wts->evaluation_weights) {
+	int lit = iter.first;
+	mpf_set_q(mval, iter.second.get_mpq_t());
+	evaluation_weights[lit] = Erld(mval);
+    }
 
-void Evaluator_mpq::evaluate_edge(mpq_class &value, Egraph_edge &e) {
-    if (e.has_zero) {
-	value = 0.0;
-	return;
+    smoothing_weights.clear();
+    for (auto iter : wts->smoothing_weights) {
+	int var = iter.first;
+	mpf_set_q(mval, iter.second.get_mpq_t());
+	smoothing_weights[var] = Erld(mval);
     }
-    std::vector<mpq_class> eval_queue;
-    for (int lit : e.literals)
-	eval_queue.push_back(weights->evaluation_weights[lit]);
-    for (int v : e.smoothing_variables)
-	eval_queue.push_back(weights->smoothing_weights[v]);
-    reduce_product(value, eval_queue);
+
+    rescale = 1.0;
+    for (mpq_class qval : wts->rescale_weights) {
+	mpf_set_q(mval, qval.get_mpq_t());
+	rescale *= Erld(mval);
+    }
+    mpf_clear(mval);
+}
+
+Erld Evaluator_erld::evaluate_edge(Egraph_edge &e) {
+    if (disabled_edges[e.id-1])
+	return Erld();
+
+    Erld eval = 1.0;
+    for (int lit : e.literals) 
+	eval *= evaluation_weights[lit];
+    for (int v : e.smoothing_variables) 
+	eval *= smoothing_weights[v];
+
     if (verblevel >= 4) {
-	char *svalue = mpq_get_str(NULL, 10, value.get_mpq_t());
-	report(4, "MPQ: Evaluating edge (%d <-- %d).  Value = %s\n", e.to_id, e.from_id, svalue);
+	mpf_class mval = eval.get_mpf();
+	mp_exp_t exp;
+	char *svalue = mpf_get_str(NULL, &exp, 10, 40, mval.get_mpf_t());
+	report(4, "ERLD: Evaluating edge (%d <-- %d).  Value = 0.%se%ld\n", e.to_id, e.from_id, svalue, exp);
 	free(svalue);
     }
-    size_t bytes = mpq_bytes(value.get_mpq_t());
-    if (bytes > max_bytes)
-	max_bytes = bytes;
+    return eval;
 }
 
-void Evaluator_mpq::evaluate(mpq_class &count) {
-    clear_evaluation();
-    reduce_product(rescale, weights->rescale_weights);
-    std::vector<mpq_class> operation_values;
+void Evaluator_erld::evaluate(mpf_class &count) {
+    std::vector<Erld> operation_values;
     operation_values.resize(egraph->operations.size());
     for (int id = 1; id <= egraph->operations.size(); id++) {
 	switch (egraph->operations[id-1].type) {
 	case NNF_TRUE:
 	case NNF_AND:
-	    operation_values[id-1] = 1;
+	    operation_values[id-1] = Erld(1.0);
 	    break;
 	case NNF_FALSE:
 	case NNF_OR:
 	default:
-	    operation_values[id-1] = 0;
+	    operation_values[id-1] = Erld(0.0);
 	}
     }
     for (Egraph_edge e : egraph->edges) {
-	char *sold = NULL;
-	char *sedge = NULL;
-
-	mpq_class product;
-	evaluate_edge(product, e);
-
-	if (verblevel >= 4) {
-	    sedge = mpq_get_str(NULL, 10, product.get_mpq_t());
-	    sold = mpq_get_str(NULL, 10, operation_values[e.to_id-1].get_mpq_t());
-	}
-
-	product *= operation_values[e.from_id-1];
+	Erld product = evaluate_edge(e) * operation_values[e.from_id-1];
 	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
 	if (multiply)
 	    operation_values[e.to_id-1] *= product;
 	else
 	    operation_values[e.to_id-1] += product;
-	size_t bytes = mpq_bytes(operation_values[e.to_id-1].get_mpq_t());
-	if (bytes > max_bytes)
-	    max_bytes = bytes;
-				 
-	if (verblevel >= 4) {
-	    char *sfrom = mpq_get_str(NULL, 10, operation_values[e.from_id-1].get_mpq_t());
-	    char *sproduct = mpq_get_str(NULL, 10, product.get_mpq_t());
-	    char *snew_val = mpq_get_str(NULL, 10, operation_values[e.to_id-1].get_mpq_t());
-	    report(4, "MPQ: Density: Updating %d from %d.  %s * %s %c %s --> %s\n",
-		   e.to_id, e.from_id, sfrom, sedge, multiply ? '*' : '+', sold, snew_val);
-	    free(sfrom); free(sold); free(sedge); free(sproduct); free(snew_val);
-	}
     }
-    count = operation_values[egraph->root_id-1];
-    //    for (int id = 1; id <= egraph->operations.size(); id++)
-    //	mpq_clear(operation_values[id-1]);
-    operation_values.clear();
+    Erld ecount = operation_values[egraph->root_id-1];
+    ecount *= rescale;
+    count = ecount.get_mpf();
+}
 
-    count *= rescale;
+/*******************************************************************************************************************
+Evaluation via intervals of extended-range doubles
+*******************************************************************************************************************/
 
-    if (verblevel >= 4) {
+Evaluator_erdi::Evaluator_erdi(Egraph *eg, Egraph_weights *wts) { 
+    egraph = eg;
+    disabled_edges = wts->disabled_edges;
+    digit_precision = 0.0;
+
+    /* Convert weight values from mpq to enclosing intervals */
+    evaluation_weights.clear();
+    for (auto iter : wts->evaluation_weights) {
+	int lit = iter.first;
+	evaluation_weights[lit] = ErdI(iter.second.get_mpq_t());
+    }
+
+    smoothing_weights.clear();
+    for (auto iter : wts->smoothing_weights) {
+	int var = iter.first;
+	smoothing_weights[var] = ErdI(iter.second.get_mpq_t());
+    }
+
+    rescale = 1.0;
+    for (mpq_class qval : wts->rescale_weights)
+	rescale *= ErdI(qval.get_mpq_t());
+}
+
+ErdI Evaluator_erdi::evaluate_edge(Egraph_edge &e) {
+    if (disabled_edges[e.id-1])
+	return ErdI();
+
+    ErdI eval = 1.0;
+    for (int lit : e.literals) 
+	eval *= evaluation_weights[lit];
+    for (int v : e.smoothing_variables) 
+	eval *= smoothing_weights[v];
+    return eval;
+}
+
+void Evaluator_erdi::evaluate(mpf_class &count, std::vector<double> *log2_gain) {
+    size_t ncount = egraph->operations.size();
+    std::vector<ErdI> operation_values;
+    operation_values.resize(ncount);
+    for (int id = 1; id <= ncount; id++) {
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    operation_values[id-1] = ErdI(1.0);
+	    break;
+	case NNF_FALSE:
+	case NNF_OR:
+	default:
+	    operation_values[id-1] = ErdI(0.0);
+	}
+    }
+    // For computing gains: Log2 of minimum magnitudes for edge and its contribution
+    std::vector<double> edge_mig;
+    std::vector<double> contribution_mig;
+    // For product nodes: Sum of finite log2 magnitudes, and number of contributions containing zero
+    std::vector<double> product_mig;
+    std::vector<int> product_zeros;
+    if (log2_gain) {
+	edge_mig.resize(egraph->edges.size());
+	contribution_mig.resize(egraph->edges.size());
+	product_mig.resize(ncount, 0.0);
+	product_zeros.resize(ncount, 0);
+    }
+    size_t eidx = 0;
+    for (Egraph_edge &e : egraph->edges) {
+	ErdI eval = evaluate_edge(e);
+	ErdI product = eval * operation_values[e.from_id-1];
+	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
+	if (log2_gain) {
+	    edge_mig[eidx] = eval.log2_mig();
+	    double cmig = product.log2_mig();
+	    contribution_mig[eidx] = cmig;
+	    if (multiply) {
+		if (cmig == -INFINITY)
+		    product_zeros[e.to_id-1]++;
+		else
+		    product_mig[e.to_id-1] += cmig;
+	    }
+	}
+	eidx++;
+	if (multiply)
+	    operation_values[e.to_id-1] *= product;
+	else
+	    operation_values[e.to_id-1] += product;
+    }
+    ErdI ecount = operation_values[egraph->root_id-1];
+    log2_root_mag = ecount.log2_mag();
+
+    if (log2_gain) {
+	/*
+	  Width of sum is at least width of each argument.  Width of product is at least
+	  width of one argument times smallest magnitude of the others.
+	  Propagate these from the root back to each node, keeping the best path
+	*/
+	log2_gain->assign(ncount, -INFINITY);
+	(*log2_gain)[egraph->root_id-1] = 0.0;
+	for (size_t i = egraph->edges.size(); i-- > 0; ) {
+	    Egraph_edge &e = egraph->edges[i];
+	    double pgain = (*log2_gain)[e.to_id-1];
+	    if (pgain == -INFINITY || edge_mig[i] == -INFINITY)
+		continue;
+	    double gain = pgain + edge_mig[i];
+	    if (egraph->operations[e.to_id-1].type == NNF_AND) {
+		int zeros = product_zeros[e.to_id-1] - (contribution_mig[i] == -INFINITY ? 1 : 0);
+		if (zeros > 0)
+		    continue;
+		gain += product_mig[e.to_id-1];
+		if (contribution_mig[i] != -INFINITY)
+		    gain -= contribution_mig[i];
+	    }
+	    if (gain > (*log2_gain)[e.from_id-1])
+		(*log2_gain)[e.from_id-1] = gain;
+	}
+    }
+
+    ecount *= rescale;
+    digit_precision = ecount.digit_precision(MAX_DIGIT_PRECISION);
+    count = ecount.get_mpf();
+}
+
+/*******************************************************************************************************************
+Evaluation via Gnu multi-precision floating-point arithmetic
+*******************************************************************************************************************/
+
+
+Evaluator_mpf::Evaluator_mpf(Egraph *eg, Egraph_weights *wts, int bit_precision) { 
+    egraph = eg;
+    // Values are allocated once
+    precision = bit_precision > 0 ? bit_precision : mpf_get_default_prec();
+    operation_values.assign(egraph->operations.size(), mpf_class(0, precision));
+    product.set_prec(precision);
+    rescale.set_prec(precision);
+    rebind(wts);
+}
+
+void Evaluator_mpf::rebind(Egraph_weights *wts) {
+    source_weights = wts;
+    disabled_edges = wts->disabled_edges;
+
+    /* Convert weight values from mpq to mpf.  Keep map entries when keys are unchanged */
+    if (!same_keys(evaluation_weights, wts->evaluation_weights))
+	evaluation_weights.clear();
+    for (auto &iter : wts->evaluation_weights) {
+	int lit = iter.first;
+	auto fiter = evaluation_weights.find(lit);
+	if (fiter == evaluation_weights.end())
+	    evaluation_weights.emplace(lit, mpf_class(iter.second, precision));
+	else
+	    fiter->second = iter.second;
+    }
+
+    if (!same_keys(smoothing_weights, wts->smoothing_weights))
+	smoothing_weights.clear();
+    for (auto &iter : wts->smoothing_weights) {
+	int var = iter.first;
+	auto fiter = smoothing_weights.find(var);
+	if (fiter == smoothing_weights.end())
+	    smoothing_weights.emplace(var, mpf_class(iter.second, precision));
+	else
+	    fiter->second = iter.second;
+    }
+
+    rescale = 1.0;
+    for (const mpq_class &qval : wts->rescale_weights)
+	rescale *= qval;
+
+}
+
+void Evaluator_mpf::set_precision(int bit_precision) {
+    if (bit_precision == precision)
+	return;
+    precision = bit_precision;
+    for (mpf_class &val : operation_values)
+	val.set_prec(precision);
+    product.set_prec(precision);
+    rescale.set_prec(precision);
+    for (auto &iter : evaluation_weights)
+	iter.second.set_prec(precision);
+    for (auto &iter : smoothing_weights)
+	iter.second.set_prec(precision);
+    // Weights must be converted again at the new precision
+    rebind(source_weights);
+}
+
+void Evaluator_mpf::evaluate_edge(mpf_class &value, Egraph_edge &e) {
+    if (disabled_edges[e.id-1]) {
+	value = 0.0;
+	return;
+    }
+    value = 1;
+    for (int lit : e.literals)
+	value *= evaluation_weights[lit];
+    for (int v : e.smoothing_variables)
+	value *= smoothing_weights[v];
+    if (verblevel >= 4) {
+	mp_exp_t exp;
+	char *svalue = mpf_get_str(NULL, &exp, 10, 40, value.get_mpf_t());
+	report(4, "MPF: Evaluating edge (%d <-- %d).  Value = 0.%se%ld\n", e.to_id, e.from_id, svalue, exp);
+	free(svalue);
+    }
+}
+
+void Evaluator_mpf::evaluate(mpf_class &count) {
+
+    for (int id = 1; id <= egraph->operations.size(); id++) {
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    operation_values[id-1] = 1;
+	    break;
+	case NNF_FALSE:
+	case NNF_OR:
+	default:
+	    operation_values[id-1] = 0;
+	}
+    }
+    for (Egraph_edge &e : egraph->edges) {
+	char *sold = NULL;
+	char *sedge = NULL;
+	mp_exp_t eold, eedge, efrom, eproduct, enew_val;	
+
+	evaluate_edge(product, e);
+
+	if (verblevel >= 4) {
+	    sedge = mpf_get_str(NULL, &eedge, 10, 40, product.get_mpf_t());
+	    sold = mpf_get_str(NULL, &eold, 10, 40, operation_values[e.to_id-1].get_mpf_t());
+	}
+
+	product *= operation_values[e.from_id-1];
+	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
+	if (multiply)
+	    operation_values[e.to_id-1] *= product;
+	else
+	    operation_values[e.to_id-1] += product;
+	if (verblevel >= 4) {
+	    char *sfrom = mpf_get_str(NULL, &efrom, 10, 40, operation_values[e.from_id-1].get_mpf_t());
+	    char *sproduct = mpf_get_str(NULL, &eproduct, 10, 40, product.get_mpf_t());
+	    char *snew_val = mpf_get_str(NULL, &enew_val, 10, 40, operation_values[e.to_id-1].get_mpf_t());
+	    report(4, "MPF: Density: Updating %d from %d.  0.%se%ld * 0.%se%ld %c 0.%se%ld --> 0.%se%ld\n",
+		   e.to_id, e.from_id, sfrom, efrom, sedge, eedge, multiply ? '*' : '+', sold, eold, snew_val, enew_val);
+	    free(sfrom); free(sold); free(sedge); free(sproduct); free(snew_val);
+	}
+    }
+    count = operation_values[egraph->root_id-1];
+    count *= rescale;
+
+    if (verblevel >= 4) {
+	mp_exp_t ecount;
+	char *scount = mpf_get_str(NULL, &ecount, 10, 40, count.get_mpf_t());
+	report(4, "MPF: Count = 0.%se%ld\n", scount, ecount);
+	free(scount);
+    }
+}
+
+/*******************************************************************************************************************
+Evaluation via Gnu multi-precision rational arithmetic
+*******************************************************************************************************************/
+
+
+static size_t mpq_bytes(mpq_srcptr val) {
+    /* Overhead */
+    size_t size = 32;
+    mpz_t mp_num, mp_den;
+    mpz_init(mp_num); mpz_init(mp_den);
+    mpq_get_num(mp_num, val);
+    size += mpz_size(mp_num) * sizeof(mp_limb_t);
+    mpq_get_den(mp_den, val);
+    size += mpz_size(mp_den) * sizeof(mp_limb_t);
+    size += 8 * ceil(0.125 * size);
+    mpz_clear(mp_num); mpz_clear(mp_den);
+    return size;
+}
+
+Evaluator_mpq::Evaluator_mpq(Egraph *eg, Egraph_weights *wts) { 
+    egraph = eg;
+    weights = wts;
+    cancel = NULL;
+    cancelled = false;
+    checkpoint_name = NULL;
+    checkpoint_resume = false;
+    checkpoint_interval = 0;
+}
+
+void Evaluator_mpq::set_checkpoint(const char *fname, bool resume, double min_interval) {
+    checkpoint_name = fname;
+    checkpoint_resume = resume;
+    checkpoint_interval = min_interval;
+}
+
+/*
+  Checkpoint file format (native byte order):
+    Magic number, version
+    Graph hash, weight hash
+    Next edge index, max bytes, number of values
+    For each value: operation ID, numerator and denominator in mpz_out_raw format
+*/
+#define CHECKPOINT_MAGIC 0x51434d57
+#define CHECKPOINT_VERSION 1
+// How often to check the time
+#define CHECKPOINT_CHECK_EDGES 16
+// Time between checkpoints is at least this multiple of the time to save one
+#define CHECKPOINT_OVERHEAD_FACTOR 50.0
+
+void Evaluator_mpq::save_checkpoint(size_t next_edge, std::vector<mpq_class> &values, std::vector<size_t> &last_use,
+				    uint64_t graph_hash, uint64_t weight_hash) {
+    std::vector<int> live;
+    for (int id = 1; id <= egraph->operations.size(); id++) {
+	if (last_use[id-1] < next_edge)
+	    continue;
+	// Values still at their initial settings need not be saved
+	nnf_type_t type = egraph->operations[id-1].type;
+	int initial = type == NNF_TRUE || type == NNF_AND ? 1 : 0;
+	if (cmp(values[id-1], initial) != 0)
+	    live.push_back(id);
+    }
+    std::string tname = std::string(checkpoint_name) + ".tmp";
+    FILE *outfile = fopen(tname.c_str(), "wb");
+    if (!outfile) {
+	err(false, "MPQ: Couldn't write checkpoint file '%s'\n", tname.c_str());
+	return;
+    }
+    uint32_t header[2] = { CHECKPOINT_MAGIC, CHECKPOINT_VERSION };
+    uint64_t state[5] = { graph_hash, weight_hash, next_edge, max_bytes, live.size() };
+    bool ok = fwrite(header, sizeof(uint32_t), 2, outfile) == 2 && fwrite(state, sizeof(uint64_t), 5, outfile) == 5;
+    for (int id : live) {
+	if (!ok)
+	    break;
+	int32_t lid = id;
+	ok = fwrite(&lid, sizeof(int32_t), 1, outfile) == 1
+	    && mpz_out_raw(outfile, mpq_numref(values[id-1].get_mpq_t())) > 0
+	    && mpz_out_raw(outfile, mpq_denref(values[id-1].get_mpq_t())) > 0;
+    }
+    if (fclose(outfile) != 0)
+	ok = false;
+    // Replace old checkpoint only once new one is complete
+    if (!ok || rename(tname.c_str(), checkpoint_name) != 0) {
+	err(false, "MPQ: Couldn't save checkpoint file '%s'\n", checkpoint_name);
+	unlink(tname.c_str());
+	return;
+    }
+    report(2, "MPQ: Saved %d values at edge %ld/%ld in checkpoint file '%s'\n",
+	   (int) live.size(), (long) next_edge, (long) egraph->edges.size(), checkpoint_name);
+}
+
+size_t Evaluator_mpq::load_checkpoint(std::vector<mpq_class> &values, uint64_t graph_hash, uint64_t weight_hash) {
+    FILE *infile = fopen(checkpoint_name, "rb");
+    if (!infile) {
+	report(1, "MPQ: No checkpoint file '%s'.  Starting from beginning\n", checkpoint_name);
+	return 0;
+    }
+    uint32_t header[2];
+    uint64_t state[5];
+    bool ok = fread(header, sizeof(uint32_t), 2, infile) == 2 && fread(state, sizeof(uint64_t), 5, infile) == 5
+	&& header[0] == CHECKPOINT_MAGIC && header[1] == CHECKPOINT_VERSION;
+    if (ok && (state[0] != graph_hash || state[1] != weight_hash)) {
+	err(false, "MPQ: Checkpoint file '%s' is for different formula or weights.  Starting from beginning\n",
+	    checkpoint_name);
+	fclose(infile);
+	return 0;
+    }
+    size_t next_edge = ok ? state[2] : 0;
+    if (next_edge > egraph->edges.size())
+	ok = false;
+    for (uint64_t i = 0; ok && i < state[4]; i++) {
+	int32_t id;
+	ok = fread(&id, sizeof(int32_t), 1, infile) == 1 && id >= 1 && id <= egraph->operations.size()
+	    && mpz_inp_raw(mpq_numref(values[id-1].get_mpq_t()), infile) > 0
+	    && mpz_inp_raw(mpq_denref(values[id-1].get_mpq_t()), infile) > 0;
+    }
+    fclose(infile);
+    if (!ok) {
+	err(false, "MPQ: Checkpoint file '%s' is invalid.  Starting from beginning\n", checkpoint_name);
+	return 0;
+    }
+    max_bytes = state[3];
+    report(1, "MPQ: Resuming at edge %ld/%ld from checkpoint file '%s'\n",
+	   (long) next_edge, (long) egraph->edges.size(), checkpoint_name);
+    return next_edge;
+}
+    
+void Evaluator_mpq::clear_evaluation() {
+    rescale = 1;
+    max_bytes = 0;
+    cancelled = false;
+}
+
+void Evaluator_mpq::evaluate_edge(mpq_class &value, Egraph_edge &e) {
+    if (weights->disabled_edges[e.id-1]) {
+	value = 0.0;
+	return;
+    }
+    std::vector<mpq_class> eval_queue;
+    for (int lit : e.literals)
+	eval_queue.push_back(weights->evaluation_weights.at(lit));
+    for (int v : e.smoothing_variables)
+	eval_queue.push_back(weights->smoothing_weights.at(v));
+    reduce_product(value, eval_queue);
+    if (verblevel >= 4) {
+	char *svalue = mpq_get_str(NULL, 10, value.get_mpq_t());
+	report(4, "MPQ: Evaluating edge (%d <-- %d).  Value = %s\n", e.to_id, e.from_id, svalue);
+	free(svalue);
+    }
+    size_t bytes = mpq_bytes(value.get_mpq_t());
+    if (bytes > max_bytes)
+	max_bytes = bytes;
+}
+
+void Evaluator_mpq::evaluate(mpq_class &count) {
+    clear_evaluation();
+    reduce_product(rescale, weights->rescale_weights);
+    std::vector<mpq_class> operation_values;
+    operation_values.resize(egraph->operations.size());
+    for (int id = 1; id <= egraph->operations.size(); id++) {
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    operation_values[id-1] = 1;
+	    break;
+	case NNF_FALSE:
+	case NNF_OR:
+	default:
+	    operation_values[id-1] = 0;
+	}
+    }
+    size_t start_edge = 0;
+    uint64_t graph_hash = 0;
+    uint64_t weight_hash = 0;
+    // For each operation, index of the last edge that refers to it
+    std::vector<size_t> last_use;
+    double next_checkpoint = 0;
+    if (checkpoint_name) {
+	graph_hash = hash_graph(egraph);
+	weight_hash = hash_weights(egraph, weights);
+	last_use.resize(egraph->operations.size(), 0);
+	for (size_t eidx = 0; eidx < egraph->edges.size(); eidx++) {
+	    last_use[egraph->edges[eidx].from_id-1] = eidx;
+	    last_use[egraph->edges[eidx].to_id-1] = eidx;
+	}
+	if (checkpoint_resume) {
+	    start_edge = load_checkpoint(operation_values, graph_hash, weight_hash);
+	    if (start_edge == 0) {
+		// Restore any values partially loaded
+		for (int id = 1; id <= egraph->operations.size(); id++) {
+		    nnf_type_t type = egraph->operations[id-1].type;
+		    operation_values[id-1] = type == NNF_TRUE || type == NNF_AND ? 1 : 0;
+		}
+	    }
+	}
+	next_checkpoint = tod() + checkpoint_interval;
+    }
+    for (size_t eidx = start_edge; eidx < egraph->edges.size(); eidx++) {
+	Egraph_edge &e = egraph->edges[eidx];
+	if (cancel && cancel->load(std::memory_order_relaxed)) {
+	    cancelled = true;
+	    count = 0;
+	    return;
+	}
+	if (checkpoint_name && eidx % CHECKPOINT_CHECK_EDGES == 0 && eidx > start_edge && tod() >= next_checkpoint) {
+	    double save_start = tod();
+	    save_checkpoint(eidx, operation_values, last_use, graph_hash, weight_hash);
+	    double save_seconds = tod() - save_start;
+	    double interval = CHECKPOINT_OVERHEAD_FACTOR * save_seconds;
+	    if (interval < checkpoint_interval)
+		interval = checkpoint_interval;
+	    next_checkpoint = tod() + interval;
+	}
+	char *sold = NULL;
+	char *sedge = NULL;
+
+	mpq_class product;
+	evaluate_edge(product, e);
+
+	if (verblevel >= 4) {
+	    sedge = mpq_get_str(NULL, 10, product.get_mpq_t());
+	    sold = mpq_get_str(NULL, 10, operation_values[e.to_id-1].get_mpq_t());
+	}
+
+	product *= operation_values[e.from_id-1];
+	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
+	if (multiply)
+	    operation_values[e.to_id-1] *= product;
+	else
+	    operation_values[e.to_id-1] += product;
+	size_t bytes = mpq_bytes(operation_values[e.to_id-1].get_mpq_t());
+	if (bytes > max_bytes)
+	    max_bytes = bytes;
+				 
+	if (verblevel >= 4) {
+	    char *sfrom = mpq_get_str(NULL, 10, operation_values[e.from_id-1].get_mpq_t());
+	    char *sproduct = mpq_get_str(NULL, 10, product.get_mpq_t());
+	    char *snew_val = mpq_get_str(NULL, 10, operation_values[e.to_id-1].get_mpq_t());
+	    report(4, "MPQ: Density: Updating %d from %d.  %s * %s %c %s --> %s\n",
+		   e.to_id, e.from_id, sfrom, sedge, multiply ? '*' : '+', sold, snew_val);
+	    free(sfrom); free(sold); free(sedge); free(sproduct); free(snew_val);
+	}
+    }
+    if (checkpoint_name)
+	unlink(checkpoint_name);
+    count = operation_values[egraph->root_id-1];
+    //    for (int id = 1; id <= egraph->operations.size(); id++)
+    //	mpq_clear(operation_values[id-1]);
+    operation_values.clear();
+
+    count *= rescale;
+
+    if (verblevel >= 4) {
 	char *scount = mpq_get_str(NULL, 10, count.get_mpq_t());
 	report(4, "MPQ: count = %s\n", scount);
 	free(scount);
     }
 }
 
+void Evaluator_mpq::evaluate_operations(std::unordered_map<int,mpq_class> &values) {
+    clear_evaluation();
+    size_t ncount = egraph->operations.size();
+    // Operations on which requested values depend.  Edges are in topological order
+    std::vector<bool> needed(ncount, false);
+    for (auto iter : values)
+	needed[iter.first-1] = true;
+    for (auto eiter = egraph->edges.rbegin(); eiter != egraph->edges.rend(); eiter++) {
+	if (needed[eiter->to_id-1])
+	    needed[eiter->from_id-1] = true;
+    }
+    std::vector<mpq_class> operation_values;
+    operation_values.resize(ncount);
+    for (int id = 1; id <= ncount; id++) {
+	if (!needed[id-1])
+	    continue;
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    operation_values[id-1] = 1;
+	    break;
+	default:
+	    operation_values[id-1] = 0;
+	}
+    }
+    for (Egraph_edge &e : egraph->edges) {
+	if (!needed[e.to_id-1])
+	    continue;
+	mpq_class product;
+	evaluate_edge(product, e);
+	product *= operation_values[e.from_id-1];
+	if (egraph->operations[e.to_id-1].type == NNF_AND)
+	    operation_values[e.to_id-1] *= product;
+	else
+	    operation_values[e.to_id-1] += product;
+	size_t bytes = mpq_bytes(operation_values[e.to_id-1].get_mpq_t());
+	if (bytes > max_bytes)
+	    max_bytes = bytes;
+    }
+    for (auto &iter : values)
+	iter.second = operation_values[iter.first-1];
+}
+
+/*******************************************************************************************************************
+Exact evaluation with power-of-two weights
+*******************************************************************************************************************/
+
+typedef unsigned __int128 uint128_t;
+
+// Value = m * 2^-exp, where m is held in small, or in big once it exceeds 128 bits
+typedef struct {
+    uint128_t small;
+    mpz_t big;
+    bool is_big;
+    int64_t exp;
+} dyadic_t;
+
+static void dyadic_init(dyadic_t &d, uint128_t m, int64_t exp) {
+    d.small = m;
+    d.is_big = false;
+    d.exp = exp;
+}
+
+static void dyadic_clear(dyadic_t &d) {
+    if (d.is_big)
+	mpz_clear(d.big);
+    d.is_big = false;
+}
+
+static void uint128_to_mpz(mpz_ptr dest, uint128_t m) {
+    uint64_t words[2];
+    words[0] = (uint64_t) m;
+    words[1] = (uint64_t) (m >> 64);
+    mpz_import(dest, 2, -1, sizeof(uint64_t), 0, 0, words);
+}
+
+static int uint128_ctz(uint128_t m) {
+    uint64_t lo = (uint64_t) m;
+    return lo != 0 ? __builtin_ctzll(lo) : 64 + __builtin_ctzll((uint64_t) (m >> 64));
+}
+
+static void dyadic_promote(dyadic_t &d) {
+    if (d.is_big)
+	return;
+    mpz_init(d.big);
+    uint128_to_mpz(d.big, d.small);
+    d.is_big = true;
+}
+
+// Multiply mantissa by 2^k, k >= 0
+static void dyadic_shift(dyadic_t &d, int64_t k) {
+    if (k == 0)
+	return;
+    if (!d.is_big) {
+	if (d.small == 0)
+	    return;
+	if (k < 128 && (d.small >> (128-k)) == 0) {
+	    d.small <<= k;
+	    return;
+	}
+	dyadic_promote(d);
+    }
+    mpz_mul_2exp(d.big, d.big, k);
+}
+
+// Remove powers of two from mantissa while exponent is positive
+static void dyadic_normalize(dyadic_t &d) {
+    if (d.exp <= 0)
+	return;
+    int64_t tz;
+    if (d.is_big) {
+	if (mpz_sgn(d.big) == 0) {
+	    d.exp = 0;
+	    return;
+	}
+	tz = mpz_scan1(d.big, 0);
+    } else {
+	if (d.small == 0) {
+	    d.exp = 0;
+	    return;
+	}
+	tz = uint128_ctz(d.small);
+    }
+    int64_t s = tz < d.exp ? tz : d.exp;
+    if (s == 0)
+	return;
+    if (d.is_big)
+	mpz_tdiv_q_2exp(d.big, d.big, s);
+    else
+	d.small >>= s;
+    d.exp -= s;
+}
+
+// a += b.  b is altered
+static void dyadic_add(dyadic_t &a, dyadic_t &b) {
+    if (a.exp < b.exp) {
+	dyadic_shift(a, b.exp - a.exp);
+	a.exp = b.exp;
+    } else if (b.exp < a.exp) {
+	dyadic_shift(b, a.exp - b.exp);
+	b.exp = a.exp;
+    }
+    if (!a.is_big && !b.is_big) {
+	uint128_t sum = a.small + b.small;
+	if (sum >= a.small) {
+	    a.small = sum;
+	    return;
+	}
+	dyadic_promote(a);
+    } else if (!a.is_big)
+	dyadic_promote(a);
+    if (b.is_big)
+	mpz_add(a.big, a.big, b.big);
+    else {
+	mpz_t t;
+	mpz_init(t);
+	uint128_to_mpz(t, b.small);
+	mpz_add(a.big, a.big, t);
+	mpz_clear(t);
+    }
+}
+
+// a *= b
+static void dyadic_mul(dyadic_t &a, dyadic_t &b) {
+    a.exp += b.exp;
+    if (!a.is_big && !b.is_big) {
+	uint128_t prod;
+	if (!__builtin_mul_overflow(a.small, b.small, &prod)) {
+	    a.small = prod;
+	    return;
+	}
+	dyadic_promote(a);
+    } else if (!a.is_big)
+	dyadic_promote(a);
+    if (b.is_big)
+	mpz_mul(a.big, a.big, b.big);
+    else {
+	mpz_t t;
+	mpz_init(t);
+	uint128_to_mpz(t, b.small);
+	mpz_mul(a.big, a.big, t);
+	mpz_clear(t);
+    }
+}
+
+static size_t dyadic_bytes(dyadic_t &d) {
+    return d.is_big ? 16 + mpz_size(d.big) * sizeof(mp_limb_t) : sizeof(dyadic_t);
+}
+
+// Return log2 of value, or INT_MIN if not a positive power of two
+static int mpq_log2(const mpq_class &val) {
+    if (sgn(val) <= 0)
+	return INT_MIN;
+    mpz_srcptr num = val.get_num_mpz_t();
+    mpz_srcptr den = val.get_den_mpz_t();
+    if (mpz_popcount(num) != 1 || mpz_popcount(den) != 1)
+	return INT_MIN;
+    return (int) mpz_scan1(num, 0) - (int) mpz_scan1(den, 0);
+}
+
+Evaluator_unweighted::Evaluator_unweighted(Egraph *eg, Egraph_weights *wts) {
+    egraph = eg;
+    disabled_edges = wts->disabled_edges;
+    applicable = true;
+    big_count = 0;
+    max_bytes = 0;
+    for (auto iter : wts->evaluation_weights) {
+	int e = mpq_log2(iter.second);
+	if (e == INT_MIN) {
+	    applicable = false;
+	    return;
+	}
+	evaluation_exponents[iter.first] = e;
+    }
+    for (auto iter : wts->smoothing_weights) {
+	int e = mpq_log2(iter.second);
+	if (e == INT_MIN) {
+	    applicable = false;
+	    return;
+	}
+	smoothing_exponents[iter.first] = e;
+    }
+    rescale_exponent = 0;
+    for (mpq_class wt : wts->rescale_weights) {
+	int e = mpq_log2(wt);
+	if (e == INT_MIN) {
+	    applicable = false;
+	    return;
+	}
+	rescale_exponent += e;
+    }
+}
+
+int64_t Evaluator_unweighted::edge_exponent(Egraph_edge &e) {
+    int64_t exp = 0;
+    for (int lit : e.literals)
+	exp += evaluation_exponents.at(lit);
+    for (int v : e.smoothing_variables)
+	exp += smoothing_exponents.at(v);
+    return exp;
+}
+
+void Evaluator_unweighted::evaluate(mpq_class &count) {
+    big_count = 0;
+    max_bytes = 0;
+    size_t ncount = egraph->operations.size();
+    std::vector<dyadic_t> operation_values(ncount);
+    for (int id = 1; id <= ncount; id++) {
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    dyadic_init(operation_values[id-1], 1, 0);
+	    break;
+	default:
+	    dyadic_init(operation_values[id-1], 0, 0);
+	}
+    }
+    dyadic_t product;
+    dyadic_init(product, 0, 0);
+    for (Egraph_edge &e : egraph->edges) {
+	dyadic_t &from = operation_values[e.from_id-1];
+	dyadic_t &to = operation_values[e.to_id-1];
+	dyadic_clear(product);
+	if (disabled_edges[e.id-1])
+	    dyadic_init(product, 0, 0);
+	else {
+	    int64_t exp = edge_exponent(e);
+	    dyadic_init(product, 1, exp < 0 ? -exp : 0);
+	    if (exp > 0)
+		dyadic_shift(product, exp);
+	}
+	dyadic_mul(product, from);
+	bool multiply = egraph->operations[e.to_id-1].type == NNF_AND;
+	if (multiply)
+	    dyadic_mul(to, product);
+	else
+	    dyadic_add(to, product);
+	dyadic_normalize(to);
+	size_t bytes = dyadic_bytes(to);
+	if (bytes > max_bytes)
+	    max_bytes = bytes;
+    }
+    dyadic_clear(product);
+    dyadic_t &root = operation_values[egraph->root_id-1];
+    dyadic_promote(root);
+    // Weights less than one can give a count with a fractional part
+    int64_t exp = rescale_exponent - root.exp;
+    mpq_set_z(count.get_mpq_t(), root.big);
+    if (exp >= 0)
+	mpq_mul_2exp(count.get_mpq_t(), count.get_mpq_t(), exp);
+    else
+	mpq_div_2exp(count.get_mpq_t(), count.get_mpq_t(), -exp);
+    for (int id = 1; id <= ncount; id++) {
+	if (operation_values[id-1].is_big)
+	    big_count++;
+	dyadic_clear(operation_values[id-1]);
+    }
+}
+
+/*******************************************************************************************************************
+Evaluation via MPFI
+*******************************************************************************************************************/
+
+Evaluator_mpfi::Evaluator_mpfi(Egraph *eg, Egraph_weights *wts, bool instr, int bit_precision) { 
+    egraph = eg;
+    // Values are allocated once
+    precision = bit_precision > 0 ? bit_precision : mpfr_get_default_prec();
+    weight_count = 0;
+    weights = NULL;
+    mpfi_init2(rescale, precision);
+    mpfi_init2(product, precision);
+    operation_values = new mpfi_t[egraph->operations.size()];
+    operation_updated = new bool[egraph->operations.size()];
+    for (int id = 1; id <= egraph->operations.size(); id++)
+	mpfi_init2(operation_values[id-1], precision);
+    load_weights(wts);
+
+    instrument = instr;
+    monitor_gain = NULL;
+    node_precision = NULL;
+    exact_values = NULL;
+    unscaled = false;
+}
+
+Evaluator_mpfi::~Evaluator_mpfi() {
+    clear_weights();
+    for (int id = 1; id <= egraph->operations.size(); id++)
+	mpfi_clear(operation_values[id-1]);
+    delete[] operation_values;
+    delete[] operation_updated;
+    mpfi_clear(product);
+    mpfi_clear(rescale);
+}
+
+void Evaluator_mpfi::clear_weights() {
+    for (int i = 0; i < weight_count; i++)
+	mpfi_clear(weights[i]);
+    delete[] weights;
+    weights = NULL;
+    weight_count = 0;
+}
+
+void Evaluator_mpfi::load_weights(Egraph_weights *wts) {
+    source_weights = wts;
+    disabled_edges = wts->disabled_edges;
+    int count = wts->evaluation_weights.size() + wts->smoothing_weights.size();
+    bool reuse = count == weight_count
+	&& same_keys(evaluation_index, wts->evaluation_weights)
+	&& same_keys(smoothing_index, wts->smoothing_weights);
+
+    if (!reuse) {
+	/* Assign new positions in weights array */
+	clear_weights();
+	weight_count = count;
+	weights = new mpfi_t[weight_count];
+	for (int idx = 0; idx < weight_count; idx++)
+	    mpfi_init2(weights[idx], precision);
+	int next_idx = 0;
+	evaluation_index.clear();
+	for (auto &iter : wts->evaluation_weights)
+	    evaluation_index[iter.first] = next_idx++;
+	smoothing_index.clear();
+	for (auto &iter : wts->smoothing_weights)
+	    smoothing_index[iter.first] = next_idx++;
+    }
+
+    /* Convert weight values from mpq to mpfi */
+    for (auto &iter : wts->evaluation_weights)
+	mpfi_set_q(weights[evaluation_index[iter.first]], iter.second.get_mpq_t());
+    for (auto &iter : wts->smoothing_weights)
+	mpfi_set_q(weights[smoothing_index[iter.first]], iter.second.get_mpq_t());
+
+    mpfi_set_d(rescale, 1.0);
+    for (const mpq_class &wt : wts->rescale_weights)
+	mpfi_mul_q(rescale, rescale, wt.get_mpq_t());
+}
+
+void Evaluator_mpfi::rebind(Egraph_weights *wts) {
+    load_weights(wts);
+}
+
+void Evaluator_mpfi::set_precision(int bit_precision) {
+    if (bit_precision == precision)
+	return;
+    precision = bit_precision;
+    for (int id = 1; id <= egraph->operations.size(); id++)
+	mpfi_set_prec(operation_values[id-1], precision);
+    for (int i = 0; i < weight_count; i++)
+	mpfi_set_prec(weights[i], precision);
+    mpfi_set_prec(product, precision);
+    mpfi_set_prec(rescale, precision);
+    // Weights must be converted again at the new precision
+    load_weights(source_weights);
+}
+    
+void Evaluator_mpfi::clear_evaluation() {
+    min_digit_precision = MAX_DIGIT_PRECISION;
+    aborted = false;
+    abort_precision = 0.0;
+}
+
+// Allow factor of 4 for differences between MPFI and ERDI magnitude bounds
+#define MONITOR_SLACK 2.0
+
+void Evaluator_mpfi::set_monitor(std::vector<double> *log2_gain, double log2_root_mag, double target_precision) {
+    monitor_gain = log2_gain;
+    monitor_root_mag = log2_root_mag;
+    monitor_limit = log2_root_mag - target_precision * log2(10.0) + MONITOR_SLACK;
+    if (log2_root_mag == -INFINITY)
+	monitor_gain = NULL;
+}
+
+void Evaluator_mpfi::evaluate_edge(mpfi_ptr value, Egraph_edge &e) {
+    if (disabled_edges[e.id-1]) {
+	mpfi_set_d(value, 0.0);
+	return;
+    }
+    mpfi_set_d(value, 1.0);
+    for (int lit : e.literals)
+	mpfi_mul(value, value, weights[evaluation_index[lit]]);
+    for (int v : e.smoothing_variables)
+	mpfi_mul(value, value, weights[smoothing_index[v]]);
+}
+
+void Evaluator_mpfi::evaluate(mpfi_ptr count) {
+    clear_evaluation();
+
+    for (int id = 1; id <= egraph->operations.size(); id++) {
+	operation_updated[id-1] = false;
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    mpfi_set_d(operation_values[id-1], 1.0);
+	    break;
+	case NNF_FALSE:
+	case NNF_OR:
+	default:
+	    mpfi_set_d(operation_values[id-1], 0.0);
+	}
+    }
+    if (exact_values) {
+	for (auto iter : *exact_values)
+	    mpfi_set_q(operation_values[iter.first-1], iter.second.get_mpq_t());
+    }
+    // Nodes whose final width has been checked
+    std::vector<bool> checked;
+    mpfr_t width;
+    if (monitor_gain) {
+	checked.resize(egraph->operations.size(), false);
+	mpfr_init2(width, 64);
+    }
+    int id = 0;
+    for (Egraph_edge &e : egraph->edges) {
+	id++;
+	if (monitor_gain && !checked[e.from_id-1]) {
+	    // Value of node is final once it is used
+	    checked[e.from_id-1] = true;
+	    double gain = (*monitor_gain)[e.from_id-1];
+	    if (gain != -INFINITY) {
+		mpfi_diam_abs(width, operation_values[e.from_id-1]);
+		long exp;
+		double d = mpfr_get_d_2exp(&exp, width, MPFR_RNDD);
+		double log2_root_width = d > 0 ? log2(d) + exp + gain : -INFINITY;
+		if (log2_root_width > monitor_limit) {
+		    aborted = true;
+		    abort_precision = (monitor_root_mag - log2_root_width + MONITOR_SLACK) * log10(2.0);
+		    if (abort_precision < 0)
+			abort_precision = 0;
+		    report(3, "MPFI: Width of node %d limits precision to %.1f digits.  Aborting after %d/%d edges\n",
+			   e.from_id, abort_precision, id, (int) egraph->edges.size());
+		    break;
+		}
+	    }
+	}
+	if (exact_values && exact_values->find(e.to_id) != exact_values->end())
+	    continue;
+	evaluate_edge(product, e);
+	report(4, "Evaluated edge #%d (%d <-- %d)\n", id, e.to_id, e.from_id);
+	mpfi_mul(product, product, operation_values[e.from_id-1]);
+	if (operation_updated[e.to_id-1]) {
+	    bool add = egraph->operations[e.to_id-1].type == NNF_OR;
+	    if (add) {
+		mpfi_add(operation_values[e.to_id-1], operation_values[e.to_id-1], product);
+		if (instrument && add) {
+		    double dp = digit_precision_mpfi(operation_values[e.to_id-1]);
+		    if (dp < min_digit_precision)
+			min_digit_precision = dp;
+		}
+	    } else 
+		mpfi_mul(operation_values[e.to_id-1], operation_values[e.to_id-1], product);
+	} else {
+	    operation_updated[e.to_id-1] = true;
+	    mpfi_swap(operation_values[e.to_id-1], product);
+	}
+    }
+    if (monitor_gain)
+	mpfr_clear(width);
+    if (node_precision && !aborted) {
+	node_precision->resize(egraph->operations.size());
+	for (int id = 1; id <= egraph->operations.size(); id++)
+	    (*node_precision)[id-1] = digit_precision_mpfi(operation_values[id-1]);
+    }
+    if (aborted)
+	mpfi_interv_d(count, -INFINITY, INFINITY);
+    else {
+	// Values stay with the evaluator, so copy at full precision
+	if (mpfi_get_prec(count) < precision)
+	    mpfi_set_prec(count, precision);
+	mpfi_set(count, operation_values[egraph->root_id-1]);
+    }
+    double dp = aborted ? 0.0 : digit_precision_mpfi(count);
+    if (dp < min_digit_precision)
+	min_digit_precision = dp;
+
+    if (!aborted && !unscaled)
+	mpfi_mul(count, count, rescale);
+}
+
+/*******************************************************************************************************************
+Streaming evaluation via MPFI
+*******************************************************************************************************************/
+
+Evaluator_stream::Evaluator_stream(int nv, Egraph_weights *wts, int bit_precision) {
+    nvar = nv;
+    precision = bit_precision;
+    weights.resize(2*nvar+1, NULL);
+    for (auto &iter : wts->evaluation_weights) {
+	int lit = iter.first;
+	if (lit < -nvar || lit > nvar)
+	    continue;
+	mpfi_ptr w = new __mpfi_struct;
+	mpfi_init2(w, precision);
+	mpfi_set_q(w, iter.second.get_mpq_t());
+	weights[lit+nvar] = w;
+    }
+    mpfi_init2(rescale, precision);
+    mpfi_set_d(rescale, 1.0);
+    for (const mpq_class &wt : wts->rescale_weights)
+	mpfi_mul_q(rescale, rescale, wt.get_mpq_t());
+    mpfi_init2(product, precision);
+    mpfi_init2(constant, precision);
+    operation_count = 0;
+    edge_count = 0;
+    allocated_values = 0;
+}
+
+Evaluator_stream::~Evaluator_stream() {
+    for (mpfi_ptr w : weights) {
+	if (w) {
+	    mpfi_clear(w);
+	    delete w;
+	}
+    }
+    for (mpfi_ptr v : operation_values) {
+	if (v) {
+	    mpfi_clear(v);
+	    delete v;
+	}
+    }
+    mpfi_clear(rescale);
+    mpfi_clear(product);
+    mpfi_clear(constant);
+}
+
+bool Evaluator_stream::add_operation(int id, nnf_type_t type) {
+    if (id <= 0) {
+	err(false, "Line %d.  Invalid operation ID %d\n", line_number, id);
+	return false;
+    }
+    if (id > operation_types.size()) {
+	operation_types.resize(id, NNF_NONE);
+	operation_values.resize(id, NULL);
+	operation_used.resize(id, false);
+    }
+    if (operation_types[id-1] != NNF_NONE) {
+	err(false, "Line %d.  Operation %d already defined\n", line_number, id);
+	return false;
+    }
+    operation_types[id-1] = type;
+    operation_count++;
+    return true;
+}
+
+mpfi_ptr Evaluator_stream::get_value(int id) {
+    if (operation_values[id-1])
+	return operation_values[id-1];
+    nnf_type_t type = operation_types[id-1];
+    mpfi_set_d(constant, type == NNF_TRUE || type == NNF_AND ? 1.0 : 0.0);
+    return constant;
+}
+
+bool Evaluator_stream::evaluate(FILE *infile, mpfi_ptr count) {
+    std::vector<int> largs;
+    int root_id = 0;
+    line_number = 0;
+    while (true) {
+	line_number++;
+	int c = get_token(infile);
+	int rc = 0;
+	if (c == EOF)
+	    break;
+	bool ok = read_numbers(infile, largs, &rc);
+	if (!ok) {
+	    err(false, "Line %d.  Couldn't parse numbers\n", line_number);
+	    return false;
+	}
+	if (c != 0) {
+	    // Operation
+	    nnf_type_t type = NNF_NONE;
+	    for (int t = NNF_TRUE; t < NNF_NUM; t++)
+		if (c == nnf_type_char[t])
+		    type = (nnf_type_t) t;
+	    if (type == NNF_NONE || largs.size() != 2 || largs.back() != 0) {
+		err(false, "Line %d.  Invalid NNF operation\n", line_number);
+		return false;
+	    }
+	    if (!add_operation(largs[0], type))
+		return false;
+	    continue;
+	}
+	// Edge
+	if (largs.size() == 0 && rc == EOF)
+	    break;
+	if (largs.size() < 3 || largs.back() != 0) {
+	    err(false, "Line %d.  Invalid NNF edge\n", line_number);
+	    return false;
+	}
+	int to_id = largs[0];
+	int from_id = largs[1];
+	if (to_id <= 0 || to_id > operation_types.size() || operation_types[to_id-1] == NNF_NONE ||
+	    from_id <= 0 || from_id > operation_types.size() || operation_types[from_id-1] == NNF_NONE) {
+	    err(false, "Line %d.  Edge refers to undefined operation\n", line_number);
+	    return false;
+	}
+	if (operation_used[to_id-1]) {
+	    err(false, "Line %d.  Operation %d updated after being used.  Can't evaluate while streaming\n",
+		line_number, to_id);
+	    return false;
+	}
+	operation_used[from_id-1] = true;
+	edge_count++;
+	mpfi_set(product, get_value(from_id));
+	// Normalized weights of smoothing variables sum to 1, so only the literals matter
+	for (int pos = 2; largs[pos] != 0; pos++) {
+	    int lit = largs[pos];
+	    if (lit < -nvar || lit > nvar || !weights[lit+nvar]) {
+		err(false, "Line %d.  Invalid literal %d\n", line_number, lit);
+		return false;
+	    }
+	    mpfi_mul(product, product, weights[lit+nvar]);
+	}
+	mpfi_ptr value = operation_values[to_id-1];
+	if (value) {
+	    if (operation_types[to_id-1] == NNF_OR)
+		mpfi_add(value, value, product);
+	    else
+		mpfi_mul(value, value, product);
+	} else {
+	    value = new __mpfi_struct;
+	    mpfi_init2(value, precision);
+	    mpfi_swap(value, product);
+	    operation_values[to_id-1] = value;
+	    allocated_values++;
+	}
+	root_id = to_id;
+    }
+    if (root_id == 0) {
+	err(false, "NNF file contains no edges\n");
+	return false;
+    }
+    if (mpfi_get_prec(count) < precision)
+	mpfi_set_prec(count, precision);
+    mpfi_mul(count, get_value(root_id), rescale);
+    return true;
+}
+
 /*******************************************************************************************************************
-Evaluation via MPFI
+Mixed-precision evaluation
 *******************************************************************************************************************/
 
-Evaluator_mpfi::Evaluator_mpfi(Egraph *eg, Egraph_weights *wts, bool instr) { 
+// Unit roundoff for double
+#define DBL_UNIT_ROUNDOFF ldexp(1.0, -53)
+// Each weight converted from MPQ has relative error at most 2 units
+#define WEIGHT_CONVERSION_ERROR 2.0
+// Account for higher-order terms in error bounds.  Valid when relative error < 1%
+#define ERROR_SLACK 1.01
+
+Evaluator_mixed::Evaluator_mixed(Egraph *eg, Egraph_weights *wts, int bit_precision) {
     egraph = eg;
+    disabled_edges = wts->disabled_edges;
+    precision = bit_precision > 0 ? bit_precision : mpfr_get_default_prec();
 
-    /* Convert weight values from mpq to mpfi */
+    mpf_t mval;
+    mpf_init2(mval, 64);
     int next_idx = 0;
     weight_count = wts->evaluation_weights.size() + wts->smoothing_weights.size();
     weights = new mpfi_t[weight_count];
@@ -1326,35 +2719,93 @@ Evaluator_mpfi::Evaluator_mpfi(Egraph *eg, Egraph_weights *wts, bool instr) {
     evaluation_index.clear();
     for (auto iter : wts->evaluation_weights) {
 	int lit = iter.first;
+	if (cmp(iter.second, 0) < 0)
+	    negative_literals.insert(lit);
+	mpf_set_q(mval, iter.second.get_mpq_t());
+	erd_evaluation_weights[lit] = Erd(mval);
 	int idx = next_idx++;
 	evaluation_index[lit] = idx;
-	mpfi_init(weights[idx]);
+	mpfi_init2(weights[idx], precision);
 	mpfi_set_q(weights[idx], iter.second.get_mpq_t());
     }
 
     smoothing_index.clear();
     for (auto iter : wts->smoothing_weights) {
 	int var = iter.first;
+	if (cmp(iter.second, 0) < 0)
+	    negative_smoothing_variables.insert(var);
+	mpf_set_q(mval, iter.second.get_mpq_t());
+	erd_smoothing_weights[var] = Erd(mval);
 	int idx = next_idx++;
 	smoothing_index[var] = idx;
-	mpfi_init(weights[idx]);
+	mpfi_init2(weights[idx], precision);
 	mpfi_set_q(weights[idx], iter.second.get_mpq_t());
     }
+    mpf_clear(mval);
 
-    mpfi_init(rescale);
+    mpfi_init2(rescale, precision);
     mpfi_set_d(rescale, 1.0);
     for (mpq_class wt : wts->rescale_weights)
 	mpfi_mul_q(rescale, rescale, wt.get_mpq_t());
 
-    instrument = instr;
+    // Classify operations.  Edges are in topological order
+    size_t ncount = egraph->operations.size();
+    indefinite.assign(ncount, false);
+    needs_interval.assign(ncount, false);
+    for (Egraph_edge &e : egraph->edges) {
+	if (indefinite[e.from_id-1] || edge_negative(e))
+	    indefinite[e.to_id-1] = true;
+    }
+    size_t icount = 0;
+    for (Egraph_edge &e : egraph->edges) {
+	if (indefinite[e.to_id-1])
+	    needs_interval[e.from_id-1] = true;
+    }
+    for (size_t id = 1; id <= ncount; id++) {
+	if (indefinite[id-1]) {
+	    needs_interval[id-1] = true;
+	    icount++;
+	}
+    }
+    needs_interval[egraph->root_id-1] = true;
+    indefinite_fraction = ncount == 0 ? 0.0 : (double) icount / ncount;
 }
-    
-void Evaluator_mpfi::clear_evaluation() {
-    min_digit_precision = MAX_DIGIT_PRECISION;
+
+Evaluator_mixed::~Evaluator_mixed() {
+    for (int i = 0; i < weight_count; i++)
+	mpfi_clear(weights[i]);
+    delete[] weights;
+    mpfi_clear(rescale);
 }
 
-void Evaluator_mpfi::evaluate_edge(mpfi_ptr value, Egraph_edge &e) {
-    if (e.has_zero) {
+bool Evaluator_mixed::edge_negative(Egraph_edge &e) {
+    for (int lit : e.literals)
+	if (negative_literals.find(lit) != negative_literals.end())
+	    return true;
+    for (int v : e.smoothing_variables)
+	if (negative_smoothing_variables.find(v) != negative_smoothing_variables.end())
+	    return true;
+    return false;
+}
+
+Erd Evaluator_mixed::evaluate_edge_erd(Egraph_edge &e, double &error) {
+    error = 0.0;
+    if (disabled_edges[e.id-1])
+	return Erd();
+    Erd eval = 1.0;
+    for (int lit : e.literals) {
+	eval *= erd_evaluation_weights[lit];
+	error += WEIGHT_CONVERSION_ERROR + 1;
+    }
+    for (int v : e.smoothing_variables) {
+	eval *= erd_smoothing_weights[v];
+	error += WEIGHT_CONVERSION_ERROR + 1;
+    }
+    return eval;
+}
+
+void Evaluator_mixed::evaluate_edge_mpfi(mpfi_ptr value, Egraph_edge &e) {
+    if (disabled_edges[e.id-1]) {
 	mpfi_set_d(value, 0.0);
 	return;
     }
@@ -1365,69 +2816,374 @@ void Evaluator_mpfi::evaluate_edge(mpfi_ptr value, Egraph_edge &e) {
 	mpfi_mul(value, value, weights[smoothing_index[v]]);
 }
 
-void Evaluator_mpfi::evaluate(mpfi_ptr count) {
-    clear_evaluation();
+/* Enclose nonnegative ERD value having relative error at most error units */
+void Evaluator_mixed::erd_to_mpfi(mpfi_ptr dest, Erd &value, double error) {
+    mpf_t mval;
+    mpf_init2(mval, 64);
+    value.get_mpf(mval);
+    mpfr_t rval;
+    mpfr_init2(rval, 64);
+    mpfr_set_f(rval, mval, MPFR_RNDN);
+    mpfi_set_fr(dest, rval);
+    double rel = error * DBL_UNIT_ROUNDOFF * ERROR_SLACK;
+    if (rel >= 0.01)
+	mpfi_interv_d(dest, 0.0, INFINITY);
+    else if (rel > 0) {
+	double lo = nextafter(1.0 - rel, 0.0);
+	double hi = nextafter(1.0 + rel, INFINITY);
+	mpfi_t factor;
+	mpfi_init2(factor, 64);
+	mpfi_interv_d(factor, lo, hi);
+	mpfi_mul(dest, dest, factor);
+	mpfi_clear(factor);
+    }
+    mpfr_clear(rval);
+    mpf_clear(mval);
+}
 
-    mpfi_t *operation_values = new mpfi_t[egraph->operations.size()];
-    bool *operation_updated = new bool[egraph->operations.size()];
-    for (int id = 1; id <= egraph->operations.size(); id++) {
-	operation_updated[id-1] = false;
-	mpfi_init(operation_values[id-1]);
+void Evaluator_mixed::evaluate(mpfi_ptr count) {
+    size_t ncount = egraph->operations.size();
+    std::vector<Erd> erd_values;
+    std::vector<double> erd_errors;
+    erd_values.resize(ncount);
+    erd_errors.assign(ncount, 0.0);
+    mpfi_t *interval_values = new mpfi_t[ncount];
+    // Has value been set?
+    std::vector<bool> updated(ncount, false);
+    // Has interval been set for sign-definite value?
+    std::vector<bool> converted(ncount, false);
+    for (int id = 1; id <= ncount; id++) {
+	bool one = false;
 	switch (egraph->operations[id-1].type) {
 	case NNF_TRUE:
 	case NNF_AND:
-	    mpfi_set_d(operation_values[id-1], 1.0);
+	    one = true;
 	    break;
-	case NNF_FALSE:
-	case NNF_OR:
 	default:
-	    mpfi_set_d(operation_values[id-1], 0.0);
+	    one = false;
+	}
+	erd_values[id-1] = Erd(one ? 1.0 : 0.0);
+	if (needs_interval[id-1]) {
+	    mpfi_init2(interval_values[id-1], precision);
+	    mpfi_set_d(interval_values[id-1], one ? 1.0 : 0.0);
 	}
     }
-    int id = 0;
-    for (Egraph_edge e : egraph->edges) {
-	id++;
-	mpfi_t product;
-	mpfi_init(product);
-	evaluate_edge(product, e);
-	report(4, "Evaluated edge #%d (%d <-- %d)\n", id, e.to_id, e.from_id);
-	mpfi_mul(product, product, operation_values[e.from_id-1]);
-	if (operation_updated[e.to_id-1]) {
-	    bool add = egraph->operations[e.to_id-1].type == NNF_OR;
-	    if (add) {
-		mpfi_add(operation_values[e.to_id-1], operation_values[e.to_id-1], product);
-		if (instrument && add) {
-		    double dp = digit_precision_mpfi(operation_values[e.to_id-1]);
-		    if (dp < min_digit_precision)
-			min_digit_precision = dp;
-		}
-	    } else 
-		mpfi_mul(operation_values[e.to_id-1], operation_values[e.to_id-1], product);
+    mpfi_t product;
+    mpfi_init2(product, precision);
+    for (Egraph_edge &e : egraph->edges) {
+	int from = e.from_id-1;
+	int to = e.to_id-1;
+	bool multiply = egraph->operations[to].type == NNF_AND;
+	if (!indefinite[to]) {
+	    double error;
+	    Erd eproduct = evaluate_edge_erd(e, error) * erd_values[from];
+	    error += erd_errors[from] + 1;
+	    if (!updated[to]) {
+		erd_values[to] = eproduct;
+		erd_errors[to] = error;
+	    } else if (multiply) {
+		erd_values[to] *= eproduct;
+		erd_errors[to] += error + 1;
+	    } else {
+		erd_values[to] += eproduct;
+		erd_errors[to] = (error > erd_errors[to] ? error : erd_errors[to]) + 1;
+	    }
 	} else {
-	    operation_updated[e.to_id-1] = true;
-	    mpfi_swap(operation_values[e.to_id-1], product);
+	    if (!indefinite[from] && !converted[from]) {
+		erd_to_mpfi(interval_values[from], erd_values[from], erd_errors[from]);
+		converted[from] = true;
+	    }
+	    evaluate_edge_mpfi(product, e);
+	    mpfi_mul(product, product, interval_values[from]);
+	    if (!updated[to])
+		mpfi_swap(interval_values[to], product);
+	    else if (multiply)
+		mpfi_mul(interval_values[to], interval_values[to], product);
+	    else
+		mpfi_add(interval_values[to], interval_values[to], product);
 	}
-	mpfi_clear(product);
+	updated[to] = true;
     }
-    mpfi_swap(count, operation_values[egraph->root_id-1]);
-    double dp = digit_precision_mpfi(count);
-    if (dp < min_digit_precision)
-	min_digit_precision = dp;
-    for (int id = 1; id <= egraph->operations.size(); id++)
-	mpfi_clear(operation_values[id-1]);
+    int root = egraph->root_id-1;
+    if (!indefinite[root])
+	erd_to_mpfi(interval_values[root], erd_values[root], erd_errors[root]);
+    mpfi_mul(count, interval_values[root], rescale);
+    mpfi_clear(product);
+    for (int id = 1; id <= ncount; id++)
+	if (needs_interval[id-1])
+	    mpfi_clear(interval_values[id-1]);
+    delete[] interval_values;
+}
 
-    delete[] operation_values;
-    delete[] operation_updated;
+/*******************************************************************************************************************
+Evaluation via multi-modular arithmetic
+*******************************************************************************************************************/
 
-    for (int i = 0; i < weight_count; i++)
-	mpfi_clear(weights[i]);
+// Largest prime will be below this value
+#define CRT_PRIME_START (((uint64_t) 1 << 62) - 1)
 
-    delete[] weights;
+static uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t p) {
+    return (uint64_t) (((unsigned __int128) a * b) % p);
+}
+
+static uint64_t add_mod(uint64_t a, uint64_t b, uint64_t p) {
+    uint64_t s = a + b;
+    return s >= p ? s - p : s;
+}
+
+static uint64_t pow_mod(uint64_t a, uint64_t e, uint64_t p) {
+    uint64_t result = 1;
+    while (e != 0) {
+	if (e & 0x1)
+	    result = mul_mod(result, a, p);
+	a = mul_mod(a, a, p);
+	e = e >> 1;
+    }
+    return result;
+}
+
+// Deterministic Miller-Rabin test for 64-bit numbers
+static bool is_prime_u64(uint64_t n) {
+    static const uint64_t bases[7] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    if (n < 2)
+	return false;
+    if (n % 2 == 0)
+	return n == 2;
+    uint64_t d = n-1;
+    int s = 0;
+    while (d % 2 == 0) {
+	d = d >> 1;
+	s++;
+    }
+    for (int i = 0; i < 7; i++) {
+	uint64_t a = bases[i] % n;
+	if (a == 0)
+	    continue;
+	uint64_t x = pow_mod(a, d, n);
+	if (x == 1 || x == n-1)
+	    continue;
+	bool composite = true;
+	for (int r = 1; r < s; r++) {
+	    x = mul_mod(x, x, n);
+	    if (x == n-1) {
+		composite = false;
+		break;
+	    }
+	}
+	if (composite)
+	    return false;
+    }
+    return true;
+}
+
+// Primes generated so far, in descending order
+// Shared by all threads.  Grows on demand
+static std::vector<uint64_t> crt_primes;
+static std::mutex crt_primes_lock;
+
+static uint64_t crt_prime(size_t index) {
+    std::lock_guard<std::mutex> guard(crt_primes_lock);
+    while (crt_primes.size() <= index) {
+	uint64_t p = crt_primes.size() == 0 ? CRT_PRIME_START : crt_primes.back() - 2;
+	while (!is_prime_u64(p))
+	    p -= 2;
+	crt_primes.push_back(p);
+    }
+    return crt_primes[index];
+}
+
+// Residue of rational value.  Denominator must not be divisible by p
+static uint64_t mpq_residue(mpq_srcptr val, uint64_t p) {
+    uint64_t num = mpz_fdiv_ui(mpq_numref(val), p);
+    uint64_t den = mpz_fdiv_ui(mpq_denref(val), p);
+    return mul_mod(num, pow_mod(den, p-2, p), p);
+}
+
+Evaluator_crt::Evaluator_crt(Egraph *eg, Egraph_weights *wts) {
+    egraph = eg;
+    weights = wts;
+
+    int next_idx = 0;
+    evaluation_index.clear();
+    for (auto iter : wts->evaluation_weights)
+	evaluation_index[iter.first] = next_idx++;
+    smoothing_index.clear();
+    for (auto iter : wts->smoothing_weights)
+	smoothing_index[iter.first] = next_idx++;
+    residues.resize(next_idx * CRT_BATCH);
+    cancel = NULL;
+
+    // Each term in graph value has at most one weight per variable
+    // Denominator must divide product of per-variable denominators
+    std::vector<mpq_class> var_denominators;
+    for (int v : egraph->data_variables) {
+	mpz_class vden = 1;
+	if (wts->evaluation_weights.find(v) != wts->evaluation_weights.end())
+	    mpz_lcm(vden.get_mpz_t(), vden.get_mpz_t(), mpq_denref(wts->evaluation_weights.at(v).get_mpq_t()));
+	if (wts->evaluation_weights.find(-v) != wts->evaluation_weights.end())
+	    mpz_lcm(vden.get_mpz_t(), vden.get_mpz_t(), mpq_denref(wts->evaluation_weights.at(-v).get_mpq_t()));
+	if (wts->smoothing_weights.find(v) != wts->smoothing_weights.end())
+	    mpz_lcm(vden.get_mpz_t(), vden.get_mpz_t(), mpq_denref(wts->smoothing_weights.at(v).get_mpq_t()));
+	if (vden != 1)
+	    var_denominators.push_back(mpq_class(vden));
+    }
+    mpq_class qden;
+    reduce_product(qden, var_denominators);
+    denominator = qden.get_num();
+    clear_evaluation();
+}
+
+void Evaluator_crt::clear_evaluation() {
+    rescale = 1;
+    prime_count = 0;
+    max_bytes = 0;
+    cancelled = false;
+}
+
+size_t Evaluator_crt::magnitude_bits() {
+    // Evaluate graph with absolute values of weights to bound magnitude of result
+    Egraph_weights abs_weights;
+    for (auto iter : weights->evaluation_weights)
+	abs_weights.evaluation_weights[iter.first] = abs(iter.second);
+    for (auto iter : weights->smoothing_weights)
+	abs_weights.smoothing_weights[iter.first] = abs(iter.second);
+    abs_weights.all_nonnegative = true;
+    abs_weights.disabled_edges = weights->disabled_edges;
+    Evaluator_erd ev = Evaluator_erd(egraph, &abs_weights);
+    mpf_class bound;
+    ev.evaluate(bound);
+    long exp = 0;
+    mpf_get_d_2exp(&exp, bound.get_mpf_t());
+    if (exp < 0)
+	exp = 0;
+    // Allow extra bit to cover rounding errors in computing bound
+    return mpz_sizeinbase(denominator.get_mpz_t(), 2) + (size_t) exp + 1;
+}
+
+void Evaluator_crt::set_residues(const uint64_t *moduli, int count) {
+    for (auto iter : evaluation_index) {
+	mpq_srcptr val = weights->evaluation_weights.at(iter.first).get_mpq_t();
+	for (int j = 0; j < count; j++)
+	    residues[iter.second * CRT_BATCH + j] = mpq_residue(val, moduli[j]);
+    }
+    for (auto iter : smoothing_index) {
+	mpq_srcptr val = weights->smoothing_weights.at(iter.first).get_mpq_t();
+	for (int j = 0; j < count; j++)
+	    residues[iter.second * CRT_BATCH + j] = mpq_residue(val, moduli[j]);
+    }
+}
 
-    mpfi_mul(count, count, rescale);
+// Evaluate graph modulo up to CRT_BATCH primes, giving residues for scaled root value
+void Evaluator_crt::evaluate_batch(uint64_t *root_values, const uint64_t *moduli, int count) {
+    set_residues(moduli, count);
+    std::vector<uint64_t> operation_values;
+    operation_values.resize(egraph->operations.size() * CRT_BATCH);
+    for (int id = 1; id <= egraph->operations.size(); id++) {
+	uint64_t init = 0;
+	switch (egraph->operations[id-1].type) {
+	case NNF_TRUE:
+	case NNF_AND:
+	    init = 1;
+	    break;
+	case NNF_FALSE:
+	case NNF_OR:
+	default:
+	    init = 0;
+	}
+	for (int j = 0; j < CRT_BATCH; j++)
+	    operation_values[(id-1) * CRT_BATCH + j] = init;
+    }
+    uint64_t product[CRT_BATCH];
+    for (Egraph_edge &e : egraph->edges) {
+	if (cancel && cancel->load(std::memory_order_relaxed)) {
+	    cancelled = true;
+	    return;
+	}
+	if (weights->disabled_edges[e.id-1]) {
+	    for (int j = 0; j < count; j++)
+		product[j] = 0;
+	} else {
+	    uint64_t *from_values = &operation_values[(e.from_id-1) * CRT_BATCH];
+	    for (int j = 0; j < count; j++)
+		product[j] = from_values[j];
+	    for (int lit : e.literals) {
+		uint64_t *wts = &residues[evaluation_index[lit] * CRT_BATCH];
+		for (int j = 0; j < count; j++)
+		    product[j] = mul_mod(product[j], wts[j], moduli[j]);
+	    }
+	    for (int v : e.smoothing_variables) {
+		uint64_t *wts = &residues[smoothing_index[v] * CRT_BATCH];
+		for (int j = 0; j < count; j++)
+		    product[j] = mul_mod(product[j], wts[j], moduli[j]);
+	    }
+	}
+	uint64_t *to_values = &operation_values[(e.to_id-1) * CRT_BATCH];
+	if (egraph->operations[e.to_id-1].type == NNF_AND) {
+	    for (int j = 0; j < count; j++)
+		to_values[j] = mul_mod(to_values[j], product[j], moduli[j]);
+	} else {
+	    for (int j = 0; j < count; j++)
+		to_values[j] = add_mod(to_values[j], product[j], moduli[j]);
+	}
+    }
+    uint64_t *values = &operation_values[(egraph->root_id-1) * CRT_BATCH];
+    for (int j = 0; j < count; j++)
+	root_values[j] = mul_mod(values[j], mpz_fdiv_ui(denominator.get_mpz_t(), moduli[j]), moduli[j]);
+}
 
+void Evaluator_crt::evaluate(mpq_class &count) {
+    clear_evaluation();
+    reduce_product(rescale, weights->rescale_weights);
+    size_t bits = magnitude_bits();
+    // Select primes, avoiding any that divide a weight denominator
+    std::vector<uint64_t> moduli;
+    size_t modulus_bits = 0;
+    for (size_t index = 0; modulus_bits <= bits; index++) {
+	uint64_t p = crt_prime(index);
+	if (mpz_divisible_ui_p(denominator.get_mpz_t(), p))
+	    continue;
+	moduli.push_back(p);
+	modulus_bits += 61;
+    }
+    prime_count = moduli.size();
+    report(3, "CRT: Scaled value requires at most %ld bits.  Using %d primes\n", (long) bits, prime_count);
+
+    // Chinese remaindering, performed incrementally
+    mpz_class value = 0;
+    mpz_class modulus = 1;
+    uint64_t root_values[CRT_BATCH];
+    for (int start = 0; start < prime_count; start += CRT_BATCH) {
+	int bcount = prime_count - start < CRT_BATCH ? prime_count - start : CRT_BATCH;
+	evaluate_batch(root_values, &moduli[start], bcount);
+	if (cancelled) {
+	    count = 0;
+	    return;
+	}
+	for (int j = 0; j < bcount; j++) {
+	    uint64_t p = moduli[start+j];
+	    uint64_t vres = mpz_fdiv_ui(value.get_mpz_t(), p);
+	    uint64_t mres = mpz_fdiv_ui(modulus.get_mpz_t(), p);
+	    uint64_t delta = add_mod(root_values[j], p - vres, p);
+	    uint64_t coeff = mul_mod(delta, pow_mod(mres, p-2, p), p);
+	    value += modulus * mpz_class((unsigned long) coeff);
+	    modulus *= mpz_class((unsigned long) p);
+	}
+    }
+    // Convert to symmetric range
+    mpz_class half = modulus / 2;
+    if (value > half)
+	value -= modulus;
 
+    count = mpq_class(value, denominator);
+    count.canonicalize();
+    count *= rescale;
+    max_bytes = mpq_bytes(count.get_mpq_t());
 
+    if (verblevel >= 4) {
+	char *scount = mpq_get_str(NULL, 10, count.get_mpq_t());
+	report(4, "CRT: count = %s\n", scount);
+	free(scount);
+    }
 }
 
 /*******************************************************************************************************************
@@ -1439,119 +3195,579 @@ Evaluation.  When no negative weights, use MPI.  Otherwise, start with MFPI and
 // Don't attempt floating-point if it requires too many bits 
 #define MPQ_THRESHOLD 1024
 
-static const char* method_name[8] = 
-    {"ERD", "MPF", "MPFI", "MPQ", "ERD_ONLY", "MPF_ONLY", "MPFI_ONLY", "MPQ_ABORT"};
+// Use mixed evaluation only when most of the graph is sign definite
+#define MIXED_THRESHOLD 0.5
+
+// Operations that lose at least this many digits relative to their arguments are candidates for exact evaluation
+#define LOCAL_LOSS_THRESHOLD 1.0
+// Don't localize exact evaluation if it would cover more than this fraction of the operations
+#define LOCAL_MAX_FRACTION 0.5
 
-Evaluator_combo::Evaluator_combo(Egraph *eg, Egraph_weights *wts, double tprecision, int bprecision, int instr) {
+// Bits beyond those of the denominator bound for first recovery attempt
+#define RECOVER_MARGIN 64
+// Give up on recovery beyond this precision
+#define RECOVER_MAX_BITS (1 << 17)
+
+static const char* method_name[20] = 
+    {"ERD", "MPF", "MPFI", "MPQ", "ERD_ONLY", "MPF_ONLY", "MPFI_ONLY", "MPQ_ABORT", "CRT",
+     "ERDD", "ERDD_ONLY", "ERLD", "ERLD_ONLY", "ERDI", "ERDI_ONLY", "MIXED", "MIXED_ONLY", "LOCAL",
+     "RECOVER", "UNWEIGHTED"};
+
+Evaluator_combo::Evaluator_combo(Egraph *eg, Egraph_weights *wts, double tprecision, int bprecision, int instr, bool crt,
+				 bool rc, bool rcv) {
     egraph = eg;
     weights = wts;
     target_precision = tprecision;
     bit_precision = bprecision;
     instrument = instr;
+    use_crt = crt;
+    race = rc;
+    recover = rcv;
+    erd_ev = NULL;
+    mpf_ev = NULL;
+    mpfi_ev = NULL;
+    checkpoint_name = NULL;
+    checkpoint_resume = false;
+    checkpoint_interval = 0;
+    mpfi_init(mpfi_count);
+    reset();
+}
+
+Evaluator_combo::~Evaluator_combo() {
+    delete erd_ev;
+    delete mpf_ev;
+    delete mpfi_ev;
+    mpfi_clear(mpfi_count);
+}
+
+void Evaluator_combo::rebind(Egraph_weights *wts, int bprecision) {
+    weights = wts;
+    bit_precision = bprecision;
+    if (erd_ev)
+	erd_ev->rebind(wts);
+    if (mpf_ev)
+	mpf_ev->rebind(wts);
+    if (mpfi_ev)
+	mpfi_ev->rebind(wts);
+    reset();
+}
+
+void Evaluator_combo::reset() {
+    exact_bytes = 0;
+    exact_method = COMPUTE_MPQ;
+    error_factor = 1.0;
+    erd_error_factor = 1.0;
     max_bytes = 24;
     erd_seconds = 0.0;
+    erdd_seconds = 0.0;
+    erld_seconds = 0.0;
+    erdi_seconds = 0.0;
+    mixed_seconds = 0.0;
     mpf_seconds = 0.0;
     mpfi_seconds = 0.0;
     mpq_seconds = 0.0;
+    crt_seconds = 0.0;
+    local_seconds = 0.0;
+    recover_seconds = 0.0;
+    unweighted_seconds = 0.0;
     mpq_count = 0.0;
     mpf_count = 0.0;
     erd_count = 0.0;
-    mpfi_init(mpfi_count);
+    erdd_count = 0.0;
+    erld_count = 0.0;
+    erdi_count = 0.0;
+    erdi_precision = 0.0;
+    mixed_count = 0.0;
+    mixed_precision = 0.0;
     mpfi_set_d(mpfi_count, 0.0);
     min_digit_precision = 0.0;
 }
 
+/*
+  Choose next precision for interval evaluation, given that evaluation with bit_precision
+  achieved only achieved_precision digits.  Assume the observed loss of bits carries over
+  to the higher precision, plus a small margin.  Result is a multiple of 64
+ */
+static int escalate_bit_precision(int bit_precision, double achieved_precision, double target_precision) {
+    // Interval contains zero.  No information about loss
+    if (achieved_precision <= 0)
+	return 64 * (int) ceil(2.0 * bit_precision / 64);
+    double lost_bits = bit_precision - achieved_precision * log2(10.0);
+    double needed_bits = target_precision * log2(10.0) + lost_bits * 1.125 + 8;
+    int next_precision = 64 * (int) ceil(needed_bits / 64);
+    int min_precision = 64 * (bit_precision / 64 + 1);
+    return next_precision < min_precision ? min_precision : next_precision;
+}
+
+/* Set count to midpoint of interval */
+static void mpfi_midpoint(mpf_class &count, mpfi_srcptr interval, int bit_precision) {
+    mpfr_t mpfr_count;
+    mpfr_init2(mpfr_count, bit_precision);
+    mpfi_mid(mpfr_count, interval);
+    mpf_t mpf_count;
+    mpf_init2(mpf_count, bit_precision);
+    mpfr_get_f(mpf_count, mpfr_count, MPFR_RNDN);
+    count = (mpf_class) mpf_count;
+    mpf_clear(mpf_count);
+    mpfr_clear(mpfr_count);
+}
+
 const char *Evaluator_combo::method() {
     return method_name[computed_method];
 }
 
+bool Evaluator_combo::recover_exact(const std::atomic<bool> *cancel) {
+    double start_time = tod();
+    // Each product includes at most one weight for each variable.
+    // Unscaled count times product of per-variable denominators must be an integer
+    std::unordered_map<int,mpz_class> variable_denominators;
+    for (auto iter : weights->evaluation_weights) {
+	mpz_class &d = variable_denominators[IABS(iter.first)];
+	if (d == 0)
+	    d = 1;
+	mpz_lcm(d.get_mpz_t(), d.get_mpz_t(), iter.second.get_den_mpz_t());
+    }
+    for (auto iter : weights->smoothing_weights) {
+	mpz_class &d = variable_denominators[iter.first];
+	if (d == 0)
+	    d = 1;
+	mpz_lcm(d.get_mpz_t(), d.get_mpz_t(), iter.second.get_den_mpz_t());
+    }
+    mpz_class denominator = 1;
+    for (auto iter : variable_denominators)
+	denominator *= iter.second;
+    int dbits = mpz_sizeinbase(denominator.get_mpz_t(), 2);
+    int bits = 64 * (int) ceil((double) (dbits + RECOVER_MARGIN) / 64);
+    report(3, "Recovering exact count.  Denominator bound has %d bits\n", dbits);
+
+    mpfr_t left, right, width;
+    mpz_t lo, hi;
+    mpz_init(lo); mpz_init(hi);
+    bool found = false;
+    while (bits <= RECOVER_MAX_BITS) {
+	if (cancel && cancel->load(std::memory_order_relaxed))
+	    break;
+	mpfi_t icount;
+	mpfi_init2(icount, bits);
+	Evaluator_mpfi ev(egraph, weights, false, bits);
+	ev.set_unscaled(true);
+	ev.evaluate(icount);
+	// Scale interval by denominator, rounding outward
+	mpfr_inits2(bits + dbits, left, right, width, (mpfr_ptr) 0);
+	mpfi_get_left(left, icount);
+	mpfi_get_right(right, icount);
+	mpfi_clear(icount);
+	mpfr_mul_z(left, left, denominator.get_mpz_t(), MPFR_RNDD);
+	mpfr_mul_z(right, right, denominator.get_mpz_t(), MPFR_RNDU);
+	mpfr_get_z(lo, left, MPFR_RNDU);
+	mpfr_get_z(hi, right, MPFR_RNDD);
+	int cmp = mpz_cmp(lo, hi);
+	if (cmp == 0)
+	    found = true;
+	else if (cmp > 0)
+	    err(false, "Recovery: No integer within scaled interval\n");
+	else {
+	    // Increase precision by number of bits in width, plus margin
+	    mpfr_sub(width, right, left, MPFR_RNDU);
+	    long wexp = mpfr_get_exp(width);
+	    int next_bits = 64 * (int) ceil((double) (bits + wexp + 8) / 64);
+	    report(3, "Recovery with %d bits left width of 2^%ld.  Retrying with %d bits\n", bits, wexp, next_bits);
+	    bits = next_bits > bits ? next_bits : bits + 64;
+	}
+	mpfr_clears(left, right, width, (mpfr_ptr) 0);
+	if (cmp >= 0)
+	    break;
+    }
+    if (found) {
+	mpq_set_num(mpq_count.get_mpq_t(), lo);
+	mpq_set_den(mpq_count.get_mpq_t(), denominator.get_mpz_t());
+	mpq_count.canonicalize();
+	mpq_class rescale;
+	reduce_product(rescale, weights->rescale_weights);
+	mpq_count *= rescale;
+	recover_seconds = tod() - start_time;
+	exact_bytes = 16 + bits/4;
+	report(3, "Recovered exact count with %d-bit MPFI in %.2f seconds\n", bits, recover_seconds);
+    }
+    mpz_clear(lo); mpz_clear(hi);
+    return found;
+}
+
+bool Evaluator_combo::compute_exact(const std::atomic<bool> *cancel) {
+    double start_time = tod();
+    if (recover) {
+	if (recover_exact(cancel)) {
+	    exact_method = COMPUTE_RECOVER;
+	    return true;
+	}
+	if (cancel && cancel->load(std::memory_order_relaxed))
+	    return false;
+	start_time = tod();
+    }
+    exact_method = use_crt ? COMPUTE_CRT : COMPUTE_MPQ;
+    if (use_crt) {
+	Evaluator_crt ev = Evaluator_crt(egraph, weights);
+	ev.set_cancel(cancel);
+	ev.evaluate(mpq_count);
+	if (ev.cancelled)
+	    return false;
+	crt_seconds = tod() - start_time;
+	exact_bytes = ev.max_bytes;
+    } else {
+	Evaluator_mpq ev = Evaluator_mpq(egraph, weights);
+	ev.set_cancel(cancel);
+	if (checkpoint_name)
+	    ev.set_checkpoint(checkpoint_name, checkpoint_resume, checkpoint_interval);
+	ev.evaluate(mpq_count);
+	if (ev.cancelled)
+	    return false;
+	mpq_seconds = tod() - start_time;
+	exact_bytes = ev.max_bytes;
+    }
+    return true;
+}
+
+void Evaluator_combo::evaluate_exact(mpf_class &count) {
+    compute_exact(NULL);
+    finish_exact(count);
+}
+
+void Evaluator_combo::finish_exact(mpf_class &count) {
+    computed_method = exact_method;
+    max_bytes = exact_bytes;
+    guaranteed_precision = MAX_DIGIT_PRECISION;
+    mpf_t mpf_count;
+    mpf_init2(mpf_count, bit_precision);
+    mpf_set_q(mpf_count, mpq_count.get_mpq_t());
+    count = (mpf_class) mpf_count;
+    mpf_clear(mpf_count);
+}
+
+bool Evaluator_combo::evaluate_local(mpf_class &count) {
+    double start_time = tod();
+    size_t ncount = egraph->operations.size();
+    std::vector<double> precision;
+    mpfi_t icount;
+    mpfi_init2(icount, bit_precision);
+    Evaluator_mpfi rev(egraph, weights, false, bit_precision);
+    rev.set_recording(&precision);
+    rev.evaluate(icount);
+
+    // Loss at operation: drop in precision relative to its least precise argument
+    // Arguments computed exactly are treated as having the working precision
+    double working_precision = bit_precision * log10(2.0);
+    std::vector<double> argument_precision(ncount, working_precision);
+    std::vector<std::vector<int>> arguments(ncount);
+    for (Egraph_edge &e : egraph->edges) {
+	arguments[e.to_id-1].push_back(e.from_id);
+	if (precision[e.from_id-1] < argument_precision[e.to_id-1])
+	    argument_precision[e.to_id-1] = precision[e.from_id-1];
+    }
+    std::vector<std::pair<double,int>> candidates;
+    for (int id = 1; id <= ncount; id++) {
+	double loss = argument_precision[id-1] - precision[id-1];
+	if (arguments[id-1].size() > 0 && loss >= LOCAL_LOSS_THRESHOLD)
+	    candidates.push_back(std::pair<double,int>(-loss, id));
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // Greedily select worst operations, limiting total size of their cones
+    std::vector<bool> in_cone(ncount, false);
+    size_t cone_size = 0;
+    size_t cone_limit = (size_t) (LOCAL_MAX_FRACTION * ncount);
+    std::unordered_map<int,mpq_class> exact_values;
+    double recovered = 0.0;
+    for (auto cand : candidates) {
+	int root = cand.second;
+	std::vector<int> added;
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (stack.size() > 0) {
+	    int id = stack.back(); stack.pop_back();
+	    if (in_cone[id-1])
+		continue;
+	    in_cone[id-1] = true;
+	    added.push_back(id);
+	    for (int aid : arguments[id-1])
+		stack.push_back(aid);
+	}
+	if (cone_size + added.size() > cone_limit) {
+	    for (int id : added)
+		in_cone[id-1] = false;
+	    continue;
+	}
+	cone_size += added.size();
+	exact_values[root] = 0;
+	recovered += -cand.first;
+    }
+    // Even removing all losses in selected operations would not reach target
+    double needed = target_precision - precision[egraph->root_id-1];
+    if (exact_values.size() == 0 || recovered < needed) {
+	report(3, "Localized exact evaluation not useful.  %d operations lose precision.  Could recover %.1f of %.1f digits\n",
+	       (int) candidates.size(), recovered, needed);
+	mpfi_clear(icount);
+	return false;
+    }
+
+    Evaluator_mpq mev = Evaluator_mpq(egraph, weights);
+    mev.evaluate_operations(exact_values);
+    Evaluator_mpfi ev(egraph, weights, false, bit_precision);
+    ev.set_exact_values(&exact_values);
+    ev.evaluate(icount);
+    double precision_local = digit_precision_mpfi(icount);
+    local_seconds = tod() - start_time;
+    report(1, "After %.2f seconds, exact evaluation of %d/%d operations (%d selected) gave guaranteed precision of %.1f\n",
+	   local_seconds, (int) cone_size, (int) ncount, (int) exact_values.size(), precision_local);
+    if (precision_local < target_precision) {
+	mpfi_clear(icount);
+	return false;
+    }
+    mpfi_midpoint(count, icount, bit_precision);
+    mpfi_clear(icount);
+    computed_method = COMPUTE_LOCAL;
+    guaranteed_precision = precision_local;
+    if (mev.max_bytes > max_bytes)
+	max_bytes = mev.max_bytes;
+    return true;
+}
+
 void Evaluator_combo::evaluate(mpf_class &count, bool no_mpq) {
+    Evaluator_unweighted uev = Evaluator_unweighted(egraph, weights);
+    if (uev.applicable) {
+	// Count exactly with scaled integers
+	double start_time = tod();
+	uev.evaluate(mpq_count);
+	computed_method = COMPUTE_UNWEIGHTED;
+	unweighted_seconds = tod() - start_time;
+	max_bytes = uev.max_bytes;
+	guaranteed_precision = MAX_DIGIT_PRECISION;
+	if (bit_precision == 0)
+	    bit_precision = required_bit_precision(target_precision, egraph->nvar, egraph->is_smoothed ? 4 : 7, true);
+	mpf_t mpf_count;
+	mpf_init2(mpf_count, bit_precision);
+	mpf_set_q(mpf_count, mpq_count.get_mpq_t());
+	count = (mpf_class) mpf_count;
+	mpf_clear(mpf_count);
+	report(3, "Power-of-two weights.  Computed exact count in %.2f seconds (%d values required MPZ)\n",
+	       unweighted_seconds, (int) uev.big_count);
+	return;
+    }
     int constant = egraph->is_smoothed ? 4 : 7;
-    if (bit_precision == 0)
-	bit_precision = required_bit_precision(target_precision, egraph->nvar, constant,
-					       weights->all_nonnegative);
+    // Use bound from graph structure when it is tighter than the general one
+    error_factor = rounding_error_bound(egraph, weights);
+    if (error_factor > egraph->nvar * constant)
+	error_factor = egraph->nvar * constant;
+    // ERD can use compensated summation, which has its own bound
+    erd_error_factor = rounding_error_bound(egraph, weights, true);
+    bool erd_compensated = erd_error_factor < error_factor;
+    if (!erd_compensated)
+	erd_error_factor = error_factor;
+    report(3, "Rounding error bound factor %.1f (general bound %d, compensated ERD %.1f)\n",
+	   error_factor, egraph->nvar * constant, erd_error_factor);
+    // Bits actually needed, before rounding up to multiple of 64
+    double needed_bits = bit_precision;
+    if (bit_precision == 0) {
+	needed_bits = minimum_bit_precision(target_precision, error_factor);
+	bit_precision = required_bit_precision(target_precision, error_factor, weights->all_nonnegative);
+	if (weights->all_nonnegative && minimum_bit_precision(target_precision, erd_error_factor) <= 52)
+	    bit_precision = 52;
+    }
+    bool erld_ok = needed_bits <= ERLD_PRECISION;
+    bool erdd_ok = needed_bits <= ERDD_PRECISION;
     if (no_mpq) {
 	computed_method = weights->all_nonnegative ? 
-	    (bit_precision < 54 ? COMPUTE_ERD_NOMPQ : COMPUTE_MPF_NOMPQ)
-	    : COMPUTE_MPFI_NOMPQ;
+	    (bit_precision < 54 ? COMPUTE_ERD_NOMPQ :
+	     erld_ok ? COMPUTE_ERLD_NOMPQ :
+	     erdd_ok ? COMPUTE_ERDD_NOMPQ : COMPUTE_MPF_NOMPQ)
+	    : (needed_bits <= DBL_MAX_PREC-2 ? COMPUTE_ERDI_NOMPQ : COMPUTE_MPFI_NOMPQ);
     } else
 	computed_method = weights->all_nonnegative ? 
-	    (bit_precision < 54 ? COMPUTE_ERD : COMPUTE_MPF)
-	    : COMPUTE_MPFI;
-    int save_precision = mpf_get_default_prec();
+	    (bit_precision < 54 ? COMPUTE_ERD :
+	     erld_ok ? COMPUTE_ERLD :
+	     erdd_ok ? COMPUTE_ERDD : COMPUTE_MPF)
+	    : (needed_bits <= DBL_MAX_PREC-2 ? COMPUTE_ERDI : COMPUTE_MPFI);
     max_bytes = 8 + bit_precision/8;
     if (bit_precision > MPQ_THRESHOLD)
-	computed_method = COMPUTE_MPQ;
+	computed_method = use_crt ? COMPUTE_CRT : COMPUTE_MPQ;
     report(3, "Achieving target precision %.1f with %d variables would require %d bit FP.  Starting with %s\n",
 	   target_precision, egraph->nvar, bit_precision, method());
 
+    // Used to detect when MPFI cannot achieve target precision
+    std::vector<double> log2_gain;
+    double log2_root_mag = 0.0;
+
     double start_time = tod();
     switch (computed_method) {
     case COMPUTE_ERD:
     case COMPUTE_ERD_NOMPQ:
 	{
 	    max_bytes = 8;
-	    Evaluator_erd ev = Evaluator_erd(egraph, weights);
-	    ev.evaluate(count);
-	    guaranteed_precision = digit_precision_bound(bit_precision, egraph->nvar, constant);
+	    if (!erd_ev)
+		erd_ev = new Evaluator_erd(egraph, weights);
+	    erd_ev->set_compensated(erd_compensated);
+	    erd_ev->evaluate(count);
+	    guaranteed_precision = digit_precision_bound(bit_precision, erd_error_factor);
 	    erd_seconds = tod() - start_time;
 	    erd_count = count;
 	}
 	break;
+    case COMPUTE_ERDD:
+    case COMPUTE_ERDD_NOMPQ:
+	{
+	    max_bytes = 24;
+	    Evaluator_erdd ev = Evaluator_erdd(egraph, weights);
+	    ev.evaluate(count);
+	    guaranteed_precision = digit_precision_bound(ERDD_PRECISION, error_factor);
+	    erdd_seconds = tod() - start_time;
+	    erdd_count = count;
+	}
+	break;
+    case COMPUTE_ERLD:
+    case COMPUTE_ERLD_NOMPQ:
+	{
+	    max_bytes = sizeof(long double);
+	    Evaluator_erld ev = Evaluator_erld(egraph, weights);
+	    ev.evaluate(count);
+	    guaranteed_precision = digit_precision_bound(ERLD_PRECISION, error_factor);
+	    erld_seconds = tod() - start_time;
+	    erld_count = count;
+	}
+	break;
     case COMPUTE_MPF:
     case COMPUTE_MPF_NOMPQ:
 	{
-	    mpf_set_default_prec(bit_precision);
-	    Evaluator_mpf ev = Evaluator_mpf(egraph, weights);
-	    ev.evaluate(count);
-	    guaranteed_precision = digit_precision_bound(bit_precision, egraph->nvar, constant);
-	    mpf_set_default_prec(save_precision);
+	    if (mpf_ev)
+		mpf_ev->set_precision(bit_precision);
+	    else
+		mpf_ev = new Evaluator_mpf(egraph, weights, bit_precision);
+	    mpf_ev->evaluate(count);
+	    guaranteed_precision = digit_precision_bound(bit_precision, error_factor);
 	    mpf_seconds = tod() - start_time;
 	    mpf_count = count;
 	}
 	break;
+    case COMPUTE_ERDI:
+    case COMPUTE_ERDI_NOMPQ:
+	{
+	    Evaluator_erdi ev = Evaluator_erdi(egraph, weights);
+	    // Gains are used to monitor MPFI, if needed
+	    ev.evaluate(count, &log2_gain);
+	    log2_root_mag = ev.log2_root_mag;
+	    erdi_seconds = tod() - start_time;
+	    erdi_count = count;
+	    erdi_precision = ev.digit_precision;
+	    if (erdi_precision >= target_precision) {
+		max_bytes = 2 * sizeof(erd_t);
+		guaranteed_precision = erdi_precision;
+		break;
+	    }
+	    // Choose MPFI precision based on loss observed with ERDI
+	    int next_precision = escalate_bit_precision(DBL_MAX_PREC-1, erdi_precision, target_precision);
+	    if (next_precision > bit_precision) {
+		bit_precision = next_precision;
+		max_bytes = 8 + bit_precision/8;
+	    }
+	    report(1, "After %.2f seconds, ERDI gave only guaranteed precision of %.1f.  Computing with %d-bit intervals\n",
+		   erdi_seconds, erdi_precision, bit_precision);
+	    computed_method = computed_method == COMPUTE_ERDI ? COMPUTE_MIXED : COMPUTE_MIXED_NOMPQ;
+	    start_time = tod();
+	}
+	// Fall through
+    case COMPUTE_MIXED:
+    case COMPUTE_MIXED_NOMPQ:
+	{
+	    // Intervals only for sign-indefinite region.  ERD with error bound elsewhere
+	    Evaluator_mixed ev(egraph, weights, bit_precision);
+	    if (ev.indefinite_fraction <= MIXED_THRESHOLD) {
+		mpfi_set_prec(mpfi_count, bit_precision);
+		ev.evaluate(mpfi_count);
+		mixed_seconds = tod() - start_time;
+		mixed_precision = digit_precision_mpfi(mpfi_count);
+		mpfi_midpoint(mixed_count, mpfi_count, bit_precision);
+		if (mixed_precision >= target_precision) {
+		    count = mixed_count;
+		    guaranteed_precision = mixed_precision;
+		    break;
+		}
+		report(1, "After %.2f seconds, mixed evaluation (%.0f%% indefinite) gave only guaranteed precision of %.1f\n",
+		       mixed_seconds, 100.0 * ev.indefinite_fraction, mixed_precision);
+	    } else
+		report(3, "Skipping mixed evaluation.  %.0f%% of operations sign indefinite\n",
+		       100.0 * ev.indefinite_fraction);
+	    computed_method = computed_method == COMPUTE_MIXED ? COMPUTE_MPFI : COMPUTE_MPFI_NOMPQ;
+	    start_time = tod();
+	}
+	// Fall through
     case COMPUTE_MPFI:
     case COMPUTE_MPFI_NOMPQ:
 	{
-	    save_precision = mpfr_get_default_prec();
-	    mpfr_set_default_prec(bit_precision);
-	    mpfi_set_prec(mpfi_count, bit_precision);
 	    max_bytes *= 2;
-	    Evaluator_mpfi ev = Evaluator_mpfi(egraph, weights, instrument);
-	    ev.evaluate(mpfi_count);
-	    mpfi_seconds = tod() - start_time;
-	    min_digit_precision = ev.min_digit_precision;
-	    guaranteed_precision = digit_precision_mpfi(mpfi_count);
-	    if (guaranteed_precision >= target_precision) {
-		mpfr_t mpfr_count;
-		mpfr_init(mpfr_count);
-		mpfi_mid(mpfr_count, mpfi_count);
-		mpf_t mpf_count;
-		mpf_init2(mpf_count, bit_precision);
-		mpfr_get_f(mpf_count, mpfr_count, MPFR_RNDN);
-		count = (mpf_class) mpf_count;
-		mpfr_set_default_prec(save_precision);		
+	    mpfi_seconds = 0.0;
+	    if (log2_gain.size() == 0) {
+		// Interval evaluation with ERDI provides information for monitoring MPFI
+		double erdi_start = tod();
+		Evaluator_erdi iev = Evaluator_erdi(egraph, weights);
+		mpf_class icount;
+		iev.evaluate(icount, &log2_gain);
+		log2_root_mag = iev.log2_root_mag;
+		report(3, "Computing MPFI monitoring information required %.2f seconds\n", tod() - erdi_start);
+	    }
+	    // Racing: exact evaluation proceeds on separate thread, until MPFI succeeds
+	    bool racing = race && !no_mpq;
+	    std::atomic<bool> cancel_exact(false);
+	    std::atomic<bool> exact_done(false);
+	    std::thread exact_thread;
+	    if (racing) {
+		report(3, "Starting %s evaluation concurrently with MPFI\n", use_crt ? "CRT" : "MPQ");
+		exact_thread = std::thread([this, &cancel_exact, &exact_done] {
+			exact_done = compute_exact(&cancel_exact);
+		    });
+	    }
+	    while (true) {
+		double mpfi_start = tod();
+		mpfi_set_prec(mpfi_count, bit_precision);
+		if (mpfi_ev)
+		    mpfi_ev->set_precision(bit_precision);
+		else
+		    mpfi_ev = new Evaluator_mpfi(egraph, weights, instrument, bit_precision);
+		mpfi_ev->set_monitor(&log2_gain, log2_root_mag, target_precision);
+		mpfi_ev->evaluate(mpfi_count);
+		mpfi_seconds += tod() - mpfi_start;
+		min_digit_precision = mpfi_ev->min_digit_precision;
+		guaranteed_precision = mpfi_ev->aborted ? mpfi_ev->abort_precision : digit_precision_mpfi(mpfi_count);
+		if (guaranteed_precision >= target_precision)
+		    break;
+		int next_precision = escalate_bit_precision(bit_precision, guaranteed_precision, target_precision);
+		if (next_precision > MPQ_THRESHOLD || exact_done)
+		    break;
+		report(1, "After %.2f seconds, %d-bit MPFI gave only guaranteed precision of %.1f.  Retrying with %d bits\n",
+		       tod() - start_time, bit_precision, guaranteed_precision, next_precision);
+		max_bytes = 2 * (8 + next_precision/8);
+		bit_precision = next_precision;
+	    }
+	    if (racing && guaranteed_precision >= target_precision && !exact_done) {
+		cancel_exact = true;
+		report(3, "MPFI succeeded after %.2f seconds.  Cancelling %s evaluation\n",
+		       tod() - start_time, use_crt ? "CRT" : "MPQ");
+	    }
+	    if (racing)
+		exact_thread.join();
+	    if (racing && exact_done) {
+		// Exact result available.  Use it
+		report(3, "%s evaluation completed after %.2f seconds\n", use_crt ? "CRT" : "MPQ", tod() - start_time);
+		finish_exact(count);
+	    } else if (guaranteed_precision >= target_precision) {
+		mpfi_midpoint(count, mpfi_count, bit_precision);
 	    } else if (no_mpq) {
 		report(1, "After %.2f seconds, MPFI gave only guaranteed precision of %.1f.  Aborting\n",
 		       tod() - start_time, guaranteed_precision);
 		count = 0.0;
 		computed_method = COMPUTE_MPQ_NOMPQ;
-	    } else {
-		mpfr_set_default_prec(save_precision);
+	    } else if (!evaluate_local(count)) {
 		// Try again
-		report(1, "After %.2f seconds, MPFI gave only guaranteed precision of %.1f.  Computing with MPQ\n",
-		       tod() - start_time, guaranteed_precision);
-		double start_time_mpq = tod();
-		Evaluator_mpq ev = Evaluator_mpq(egraph, weights);
-		ev.evaluate(mpq_count);
-		computed_method = COMPUTE_MPQ;
-		guaranteed_precision = MAX_DIGIT_PRECISION;
-		mpq_seconds = tod() - start_time_mpq;
-		mpf_t mpf_count;
-		mpf_init2(mpf_count, bit_precision);
-		mpf_set_q(mpf_count, mpq_count.get_mpq_t());
-		count = (mpf_class) mpf_count;
-		max_bytes = ev.max_bytes;
+		report(1, "After %.2f seconds, MPFI gave only guaranteed precision of %.1f.  Computing with %s\n",
+		       tod() - start_time, guaranteed_precision, use_crt ? "CRT" : "MPQ");
+		evaluate_exact(count);
 	    }
 	}
 	break;
@@ -1560,17 +3776,9 @@ void Evaluator_combo::evaluate(mpf_class &count, bool no_mpq) {
 	count = 0.0;
 	break;
     case COMPUTE_MPQ:
-	{
-	    Evaluator_mpq ev = Evaluator_mpq(egraph, weights);
-	    ev.evaluate(mpq_count);
-	    guaranteed_precision = MAX_DIGIT_PRECISION;
-	    mpf_t mpf_count;
-	    mpf_init2(mpf_count, bit_precision);
-	    mpf_set_q(mpf_count, mpq_count.get_mpq_t());
-	    count = (mpf_class) mpf_count;
-	    max_bytes = ev.max_bytes;
-	    mpq_seconds = tod() - start_time;
-	}
+    case COMPUTE_CRT:
+	evaluate_exact(count);
+	break;
     }
     report(3, "Total time for evaluation %.2f seconds.  Method %s, Guaranteed precision %.1f\n",
 	   tod() - start_time, method(), guaranteed_precision);
@@ -35,7 +35,12 @@
 #include <stdarg.h>
 
 #include <vector>
+#include <algorithm>
+#include <new>
 #include <unordered_set>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
 
 #include <gmp.h>
 #include <gmpxx.h>
@@ -44,8 +49,14 @@
 #include <mpfi.h>
 
 #include "Erd.hh"
+#include "Erdd.hh"
+#include "Erld.hh"
+#include "ErdI.hh"
 #include "q25.h"
 
+// The Q25 package keeps global state.  Hold this lock while using it
+extern std::recursive_mutex q25_lock;
+
 // Should double and Erd products be computed directly or via product reduction?
 #define PRODUCT_DIRECT 1
 
@@ -58,6 +69,13 @@
 */
 double digit_precision_bound(int bit_precision, int nvar, double constant);
 
+/*
+  Minimum number of bits of floating-point precision to achieve
+  target digit precision when all weights are nonnegative.
+  Not rounded to a valid MPF precision
+ */
+double minimum_bit_precision(double target_precision, int nvar, double constant);
+
 /*
   How many bits of floating-point precision are required to achieve
   target digit precision when all weights are nonnegative?
@@ -65,6 +83,40 @@ double digit_precision_bound(int bit_precision, int nvar, double constant);
  */
 int required_bit_precision(double target_precision, int nvar, double constant, bool nonnegative);
 
+/*
+  Versions of the above where the relative error is bounded by error_factor * 2^-bit_precision.
+  Bound nvar * constant holds for any formula.
+ */
+double digit_precision_bound(int bit_precision, double error_factor);
+double minimum_bit_precision(double target_precision, double error_factor);
+int required_bit_precision(double target_precision, double error_factor, bool nonnegative);
+
+class Egraph;
+struct Egraph_weights;
+
+/*
+  Error factor derived from structure of graph.
+  Counts roundings along the worst path from the leaves to the root.
+  With compensated summation, a sum of any fan-in incurs about one rounding
+ */
+double rounding_error_bound(Egraph *egraph, Egraph_weights *weights, bool compensated = false);
+
+
+/*
+  Hashes for identifying cached results.
+  Graph hash covers structure and data variables.  Weight hash covers the prepared weights
+ */
+uint64_t hash_graph(Egraph *egraph);
+uint64_t hash_weights(Egraph *egraph, Egraph_weights *weights);
+uint64_t hash_string(const char *s);
+
+/*
+  Memory estimates for scheduling evaluations.
+  Each product includes at most one weight for each variable, and so the MPQ prediction
+  bounds the size of every value by summing the sizes of the per-variable weights
+ */
+size_t graph_bytes(Egraph *egraph);
+size_t predict_mpq_bytes(Egraph *egraph, Egraph_weights *weights);
 
 const char *mpf_string(mpf_srcptr val, int digits);
 const char *mpfr_string(mpfr_srcptr val, int digits);
@@ -82,53 +134,104 @@ double digit_precision_mpfi(mpfi_srcptr v);
 
 typedef enum { NNF_NONE, NNF_TRUE, NNF_FALSE, NNF_AND, NNF_OR, NNF_NUM } nnf_type_t;
 
+/*
+  Graph containers can be allocated from an arena, so that a finished graph
+  can be placed in shared memory (see shared_graph.hh).  Space within an arena is never freed.
+  By default, containers use the heap
+ */
+struct Egraph_arena {
+    uintptr_t next;
+    uintptr_t limit;
+    // Throws std::bad_alloc when arena is full
+    void *allocate(size_t bytes);
+    // Space used by allocation of bytes
+    static size_t rounded(size_t bytes) { return (bytes + 15) & ~(size_t) 15; }
+};
+
+template <class T> struct Egraph_allocator {
+    typedef T value_type;
+    Egraph_arena *arena;
+
+    Egraph_allocator() : arena(NULL) {}
+    Egraph_allocator(Egraph_arena *a) : arena(a) {}
+    template <class U> Egraph_allocator(const Egraph_allocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+    { return (T *) (arena ? arena->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T))); }
+    void deallocate(T *p, size_t n)
+    { if (!arena) ::operator delete(p); }
+    // Copies of containers go on the heap
+    Egraph_allocator select_on_container_copy_construction() const { return Egraph_allocator(); }
+};
+
+template <class T, class U> bool operator==(const Egraph_allocator<T> &a, const Egraph_allocator<U> &b)
+{ return a.arena == b.arena; }
+template <class T, class U> bool operator!=(const Egraph_allocator<T> &a, const Egraph_allocator<U> &b)
+{ return a.arena != b.arena; }
+
+template <class T> using egraph_vector = std::vector<T, Egraph_allocator<T>>;
+
 struct Egraph_operation {
     int indegree;
     nnf_type_t type;
 };
 
 struct Egraph_edge {
+    // Position in list of edges, starting at 1
+    int id;
     int from_id;
     int to_id;
-    // Disabled due to zero weight or smoothing value
-    bool has_zero;
-    std::vector<int> literals;
-    std::vector<int> smoothing_variables;
+    egraph_vector<int> literals;
+    egraph_vector<int> smoothing_variables;
 };
 
+/*
+  Weights applied to a graph.  Holds all state that depends on the weights, so that the graph
+  itself is not modified, and can be shared by concurrent evaluations
+ */
 struct Egraph_weights {
     std::unordered_map<int,mpq_class> evaluation_weights;
     std::unordered_map<int,mpq_class> smoothing_weights;
     std::vector<mpq_class> rescale_weights;
     bool all_nonnegative;
+    // Edges disabled because they would require smoothing a variable with zero weight sum.
+    // Indexed by edge id - 1
+    std::vector<bool> disabled_edges;
+    int disabled_edge_count;
+    // Number of zero-sum variables that caused edges to be disabled
+    int zero_variable_count;
 };
 
 class Egraph {
 public:
-    std::vector<Egraph_operation> operations;
-    std::vector<Egraph_edge> edges;
+    egraph_vector<Egraph_operation> operations;
+    egraph_vector<Egraph_edge> edges;
     int root_id;
-    std::unordered_set<int> *data_variables;
+    // In order given by CNF, and sorted for lookup
+    egraph_vector<int> data_variables;
+    egraph_vector<int> sorted_data_variables;
     bool is_smoothed;
     int smooth_variable_count;
-    int disabled_edge_count;
     // Count of variables in original formula, including those eliminated by projection
     int nvar;
 
     Egraph(std::unordered_set<int> *data_variables, int nvar);
+    // Copy of graph with containers allocated from arena.  Throws std::bad_alloc if arena too small
+    Egraph(const Egraph &graph, Egraph_arena *arena);
+    // Space required to copy graph into arena, including the graph itself
+    size_t arena_bytes() const;
     void read_nnf(FILE *infile);
     void write_nnf(FILE *outfile);
 
+    // Does not modify the graph
     Egraph_weights *prepare_weights(std::unordered_map<int,const char *> *literal_string_weights);
     void smooth();
 
-    // Ability to do partial smoothing
-    // Remove all smoothing variables
-    void reset_smooth();
-    // Put in single smoothing variable.  If is_zero, then disable edge
-    void smooth_single(int var, bool is_zero);
+    // Mark edges that would require smoothing variable var as disabled, since its weights sum to zero.
+    // disabled_edges must have an entry for each edge.  Returns number of edges newly disabled
+    int disable_zero_variable(int var, std::vector<bool> &disabled_edges) const;
 
-    bool is_data_variable(int var) { return data_variables->find(var) != data_variables->end(); }
+    bool is_data_variable(int var) { return std::binary_search(sorted_data_variables.begin(), sorted_data_variables.end(), var); }
     bool is_literal(int lit) { return lit < 0 ? is_data_variable(-lit) : is_data_variable(lit); }
     bool is_operation(int id) { return id > 0 && id <= operations.size(); }
 
@@ -136,6 +239,10 @@ public:
     int add_edge(int from_id, int to_id);
     void add_edge_literal(int eid, int lit);
     void add_smoothing_variable(int eid, int var);
+
+private:
+    // Current line number while reading
+    int line_number;
 };
 
 /*******************************************************************************************************************
@@ -145,6 +252,8 @@ Evaluation via Q25
 class Evaluator_q25 {
 private:
     Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
     // For evaluation
     std::unordered_map<int,q25_ptr> evaluation_weights;
     std::unordered_map<int,q25_ptr> smoothing_weights;
@@ -172,6 +281,8 @@ Evaluation via double-precision floating point
 class Evaluator_double {
 private:
     Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
     // For evaluation
     std::unordered_map<int,double> evaluation_weights;
     std::unordered_map<int,double> smoothing_weights;
@@ -187,8 +298,12 @@ public:
     // literal_weights == NULL for unweighted
     double evaluate();
     void clear_evaluation();
+    // Use compensated summation for OR nodes
+    void set_compensated(bool c) { compensated = c; }
     
 private:
+    bool compensated;
+
     double evaluate_edge(Egraph_edge &e);
 };
 
@@ -199,6 +314,8 @@ Evaluation via extended-range double-precision.  Use MPF as way to get weights o
 class Evaluator_erd {
 private:
     Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
     // For evaluation
     std::unordered_map<int,Erd> evaluation_weights;
     std::unordered_map<int,Erd> smoothing_weights;
@@ -213,15 +330,104 @@ private:
 public:
 
     Evaluator_erd(Egraph *egraph, Egraph_weights *weights);
+    // Use new weights for subsequent evaluations
+    void rebind(Egraph_weights *weights);
     // literal_weights == NULL for unweighted
     void evaluate(mpf_class &count);
     void clear_evaluation();
+    // Use compensated summation for OR nodes
+    void set_compensated(bool c) { compensated = c; }
 
 private:
+    bool compensated;
+    // Reused across evaluations
+    std::vector<Erd> operation_values;
+    std::vector<Erd> compensation;
+
     Erd evaluate_edge(Egraph_edge &e);
 };
 
 
+/*******************************************************************************************************************
+Evaluation via extended-range double-double.  Use MPF as way to get weights out
+*******************************************************************************************************************/
+
+class Evaluator_erdd {
+private:
+    Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
+    // For evaluation
+    std::unordered_map<int,Erdd> evaluation_weights;
+    std::unordered_map<int,Erdd> smoothing_weights;
+
+    Erdd rescale;
+
+public:
+
+    Evaluator_erdd(Egraph *egraph, Egraph_weights *weights);
+    void evaluate(mpf_class &count);
+    void clear_evaluation();
+
+private:
+    Erdd evaluate_edge(Egraph_edge &e);
+};
+
+/*******************************************************************************************************************
+Evaluation via extended-range long double.  Use MPF as way to get weights out
+*******************************************************************************************************************/
+
+class Evaluator_erld {
+private:
+    Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
+    // For evaluation
+    std::unordered_map<int,Erld> evaluation_weights;
+    std::unordered_map<int,Erld> smoothing_weights;
+
+    Erld rescale;
+
+public:
+
+    Evaluator_erld(Egraph *egraph, Egraph_weights *weights);
+    void evaluate(mpf_class &count);
+    void clear_evaluation();
+
+private:
+    Erld evaluate_edge(Egraph_edge &e);
+};
+
+/*******************************************************************************************************************
+Evaluation via intervals of extended-range doubles.  Gives certified bounds for arbitrary weights
+*******************************************************************************************************************/
+
+class Evaluator_erdi {
+private:
+    Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
+    // For evaluation
+    std::unordered_map<int,ErdI> evaluation_weights;
+    std::unordered_map<int,ErdI> smoothing_weights;
+
+    ErdI rescale;
+
+public:
+
+    Evaluator_erdi(Egraph *egraph, Egraph_weights *weights);
+    // Sets count to midpoint of interval.
+    // Optionally compute log2 of gain for each node (see Evaluator_mpfi::set_monitor)
+    void evaluate(mpf_class &count, std::vector<double> *log2_gain = NULL);
+    // Digit precision guaranteed by interval width
+    double digit_precision;
+    // Log2 of upper bound on magnitude of unscaled root value
+    double log2_root_mag;
+
+private:
+    ErdI evaluate_edge(Egraph_edge &e);
+};
+
 /*******************************************************************************************************************
 Evaluation via Gnu multi-precision floating point
 *******************************************************************************************************************/
@@ -229,14 +435,26 @@ Evaluation via Gnu multi-precision floating point
 class Evaluator_mpf {
 private:
     Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
     // For evaluation
     std::unordered_map<int,mpf_class> evaluation_weights;
     std::unordered_map<int,mpf_class> smoothing_weights;
     mpf_class rescale;
+    // Reused across evaluations
+    int precision;
+    Egraph_weights *source_weights;
+    std::vector<mpf_class> operation_values;
+    mpf_class product;
 
 public:
 
-    Evaluator_mpf(Egraph *egraph, Egraph_weights *weights);
+    // Precision of 0 indicates the MPF default precision
+    Evaluator_mpf(Egraph *egraph, Egraph_weights *weights, int bit_precision = 0);
+    // Use new weights for subsequent evaluations
+    void rebind(Egraph_weights *weights);
+    // Change precision of weights and values
+    void set_precision(int bit_precision);
     // literal_weights == NULL for unweighted
     void evaluate(mpf_class &count);
     void clear_evaluation();
@@ -264,9 +482,59 @@ public:
     void clear_evaluation();
     // Maximum number of bytes in MPQ representation of any generated value
     size_t max_bytes;
-    
+    // Abandon evaluation when flag becomes true.  Sets cancelled
+    void set_cancel(const std::atomic<bool> *flag) { cancel = flag; }
+    bool cancelled;
+    // Compute exact values (without rescaling) of the operations given as keys in values.
+    // Only evaluates the operations these depend on
+    void evaluate_operations(std::unordered_map<int,mpq_class> &values);
+    // Periodically save state of evaluation in file, at least min_interval seconds apart.
+    // With resume, continue from state saved in file.  File removed once evaluation completes
+    void set_checkpoint(const char *fname, bool resume, double min_interval);
+
 private:
+    const std::atomic<bool> *cancel;
+    const char *checkpoint_name;
+    bool checkpoint_resume;
+    double checkpoint_interval;
+
     void evaluate_edge(mpq_class &value, Egraph_edge &e);
+    // Save values of operations still needed when starting at edge index next_edge
+    void save_checkpoint(size_t next_edge, std::vector<mpq_class> &values, std::vector<size_t> &last_use,
+			 uint64_t graph_hash, uint64_t weight_hash);
+    // Restore values and return edge index at which to continue.  Returns 0 if no valid checkpoint
+    size_t load_checkpoint(std::vector<mpq_class> &values, uint64_t graph_hash, uint64_t weight_hash);
+};
+
+/*******************************************************************************************************************
+Exact evaluation when all weights are powers of two, as is the case for unweighted counting.
+Values are represented as m * 2^-e, with m held in 128-bit integer until it overflows, and then in MPZ
+*******************************************************************************************************************/
+
+class Evaluator_unweighted {
+private:
+    Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
+    // Log2 of each weight
+    std::unordered_map<int,int> evaluation_exponents;
+    std::unordered_map<int,int> smoothing_exponents;
+    int64_t rescale_exponent;
+
+public:
+
+    Evaluator_unweighted(Egraph *egraph, Egraph_weights *weights);
+    // Are all weights powers of two?
+    bool applicable;
+    // Requires applicable
+    void evaluate(mpq_class &count);
+    // Number of operation values that required MPZ
+    size_t big_count;
+    // Maximum number of bytes in representation of any generated value
+    size_t max_bytes;
+
+private:
+    int64_t edge_exponent(Egraph_edge &e);
 };
 
 /*******************************************************************************************************************
@@ -276,6 +544,8 @@ Evaluation via MPFI interval floating point
 class Evaluator_mpfi {
 private:
     Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
     // For evaluation.  Each index indicates position in weights array
     std::unordered_map<int,int> evaluation_index;
     std::unordered_map<int,int> smoothing_index;
@@ -283,27 +553,205 @@ private:
     mpfi_t *weights;
 
     mpfi_t rescale;
+    // Reused across evaluations
+    int precision;
+    Egraph_weights *source_weights;
+    mpfi_t *operation_values;
+    bool *operation_updated;
+    mpfi_t product;
     // Measure precision of intermdiate results
     bool instrument;
+    // Monitoring of interval widths
+    std::vector<double> *monitor_gain;
+    double monitor_root_mag;
+    double monitor_limit;
+    // Recording of digit precision for each node
+    std::vector<double> *node_precision;
+    // Operations having exact values supplied externally
+    std::unordered_map<int,mpq_class> *exact_values;
+    // Omit final multiplication by rescaling factor
+    bool unscaled;
 
 public:
 
-    Evaluator_mpfi(Egraph *egraph, Egraph_weights *weights, bool instrument);
+    // Precision of 0 indicates the MPFR default precision
+    Evaluator_mpfi(Egraph *egraph, Egraph_weights *weights, bool instrument, int bit_precision = 0);
+    ~Evaluator_mpfi();
+    // Use new weights for subsequent evaluations
+    void rebind(Egraph_weights *weights);
+    // Change precision of weights and values
+    void set_precision(int bit_precision);
     void evaluate(mpfi_ptr count);
     void clear_evaluation();
     // Least digit precision estimate encountered.  Only computed when instrument.
     double min_digit_precision;
+    // Abort once target precision becomes unreachable.
+    // For each node, log2_gain gives log2 of lower bound on factor by which
+    // node's interval width is carried into the root's width
+    void set_monitor(std::vector<double> *log2_gain, double log2_root_mag, double target_precision);
+    // Was evaluation abandoned?  If so, upper bound on achievable digit precision
+    bool aborted;
+    double abort_precision;
+    // Record digit precision of each node's value
+    void set_recording(std::vector<double> *precision) { node_precision = precision; }
+    // Use exact values for some operations, rather than evaluating their arguments
+    void set_exact_values(std::unordered_map<int,mpq_class> *values) { exact_values = values; }
+    // Don't apply rescaling to final result
+    void set_unscaled(bool u) { unscaled = u; }
 
 private:
     void evaluate_edge(mpfi_ptr value, Egraph_edge &e);
+    // Convert weights at current precision
+    void load_weights(Egraph_weights *weights);
+    void clear_weights();
+
+    // Not copyable
+    Evaluator_mpfi(const Evaluator_mpfi &);
+    Evaluator_mpfi& operator=(const Evaluator_mpfi &);
+};
+
+/*******************************************************************************************************************
+Streaming evaluation via MPFI.  Evaluates each edge as it is read from an NNF file, without constructing a graph.
+Requires that all edges into an operation precede its uses, as with d4 output.
+Weights must be prepared for an unsmoothed graph, with no zero-sum variables
+*******************************************************************************************************************/
+
+class Evaluator_stream {
+private:
+    int nvar;
+    int precision;
+    // Indexed by literal + nvar
+    std::vector<mpfi_ptr> weights;
+    mpfi_t rescale;
+    // Values of operations, allocated when first updated
+    std::vector<nnf_type_t> operation_types;
+    std::vector<mpfi_ptr> operation_values;
+    // Operation has been used as the argument of another
+    std::vector<bool> operation_used;
+    mpfi_t product;
+    mpfi_t constant;
+
+public:
+
+    Evaluator_stream(int nvar, Egraph_weights *weights, int bit_precision);
+    ~Evaluator_stream();
+    // Return false if input is invalid
+    bool evaluate(FILE *infile, mpfi_ptr count);
+    // Statistics
+    int operation_count;
+    long edge_count;
+    int allocated_values;
+
+private:
+    bool add_operation(int id, nnf_type_t type);
+    // Get value of operation, which may not have been updated
+    mpfi_ptr get_value(int id);
+    int line_number;
+
+    // Not copyable
+    Evaluator_stream(const Evaluator_stream &);
+    Evaluator_stream& operator=(const Evaluator_stream &);
+};
+
+/*******************************************************************************************************************
+Mixed-precision evaluation.  Operations whose support contains no negative weight are evaluated with ERD,
+tracking a rigorous bound on the relative error.  The remaining operations are evaluated with MPFI,
+converting ERD values to enclosing intervals at the boundary
+*******************************************************************************************************************/
+
+class Evaluator_mixed {
+private:
+    Egraph *egraph;
+    // Edges disabled by the weights
+    std::vector<bool> disabled_edges;
+    // Weights for ERD evaluation
+    std::unordered_map<int,Erd> erd_evaluation_weights;
+    std::unordered_map<int,Erd> erd_smoothing_weights;
+    // Weights for MPFI evaluation.  Each index indicates position in weights array
+    std::unordered_map<int,int> evaluation_index;
+    std::unordered_map<int,int> smoothing_index;
+    int weight_count;
+    mpfi_t *weights;
+    mpfi_t rescale;
+    // Literals and smoothing variables with negative weights
+    std::unordered_set<int> negative_literals;
+    std::unordered_set<int> negative_smoothing_variables;
+    // Operations that depend on a negative weight
+    std::vector<bool> indefinite;
+    // Operations that require interval values
+    std::vector<bool> needs_interval;
+    int precision;
+
+public:
+
+    // Precision of intervals.  0 indicates the MPFR default precision
+    Evaluator_mixed(Egraph *egraph, Egraph_weights *weights, int bit_precision = 0);
+    ~Evaluator_mixed();
+    void evaluate(mpfi_ptr count);
+    // Fraction of operations evaluated with MPFI
+    double indefinite_fraction;
+
+private:
+    bool edge_negative(Egraph_edge &e);
+    // Error bounds are in units of the double unit roundoff
+    Erd evaluate_edge_erd(Egraph_edge &e, double &error);
+    void evaluate_edge_mpfi(mpfi_ptr value, Egraph_edge &e);
+    void erd_to_mpfi(mpfi_ptr dest, Erd &value, double error);
+};
+
+/*******************************************************************************************************************
+Evaluation via multi-modular arithmetic.  Evaluate modulo a set of 62-bit primes
+and reconstruct the exact value by Chinese remaindering
+*******************************************************************************************************************/
+
+// Number of primes evaluated together on each pass over the edges
+#define CRT_BATCH 8
+
+class Evaluator_crt {
+private:
+    Egraph *egraph;
+    Egraph_weights *weights;
+    // Scaling the graph value by this gives an integer
+    mpz_class denominator;
+    mpq_class rescale;
+    // For evaluation.  Each index indicates position in residue array
+    std::unordered_map<int,int> evaluation_index;
+    std::unordered_map<int,int> smoothing_index;
+    // Weight residues.  CRT_BATCH entries per weight
+    std::vector<uint64_t> residues;
+
+public:
+
+    Evaluator_crt(Egraph *egraph, Egraph_weights *weights);
+    void evaluate(mpq_class &count);
+    void clear_evaluation();
+    // Number of primes used in last evaluation
+    int prime_count;
+    // Number of bytes in MPQ representation of result
+    size_t max_bytes;
+    // Abandon evaluation when flag becomes true.  Sets cancelled
+    void set_cancel(const std::atomic<bool> *flag) { cancel = flag; }
+    bool cancelled;
+
+private:
+    const std::atomic<bool> *cancel;
+
+    // Upper bound on log2 of absolute value of scaled graph value
+    size_t magnitude_bits();
+    void set_residues(const uint64_t *moduli, int count);
+    void evaluate_batch(uint64_t *root_values, const uint64_t *moduli, int count);
 };
 
 /*******************************************************************************************************************
-Evaluation.  When no negative weights, use MPI.  Otherwise, start with MFPI and switch to MPQ if needed
+Evaluation.  When no negative weights, use ERD, ERLD, ERDD, or MPF.  Otherwise, escalate from ERDI
+through mixed ERD/MPFI and MPFI at increasing precision, and switch to exact evaluation if needed
 *******************************************************************************************************************/
 
-typedef enum { COMPUTE_ERD, COMPUTE_MPF, COMPUTE_MPFI, COMPUTE_MPQ, 
-	       COMPUTE_ERD_NOMPQ, COMPUTE_MPF_NOMPQ, COMPUTE_MPFI_NOMPQ, COMPUTE_MPQ_NOMPQ } computed_t;
+typedef enum { COMPUTE_ERD, COMPUTE_MPF, COMPUTE_MPFI, COMPUTE_MPQ,
+	       COMPUTE_ERD_NOMPQ, COMPUTE_MPF_NOMPQ, COMPUTE_MPFI_NOMPQ, COMPUTE_MPQ_NOMPQ,
+	       COMPUTE_CRT, COMPUTE_ERDD, COMPUTE_ERDD_NOMPQ,
+	       COMPUTE_ERLD, COMPUTE_ERLD_NOMPQ, COMPUTE_ERDI, COMPUTE_ERDI_NOMPQ,
+	       COMPUTE_MIXED, COMPUTE_MIXED_NOMPQ, COMPUTE_LOCAL, COMPUTE_RECOVER, COMPUTE_UNWEIGHTED } computed_t;
 
 class Evaluator_combo {
 private:
@@ -313,10 +761,24 @@ private:
     double target_precision;
     int bit_precision;
     int instrument;
+    // Use multi-modular arithmetic rather than MPQ for exact evaluation
+    bool use_crt;
+    // Run exact evaluation concurrently with MPFI
+    bool race;
+    // Attempt to recover exact value from MPFI before using MPQ or CRT
+    bool recover;
+    // Floating-point evaluators.  Created when first needed and reused across weight sets
+    Evaluator_erd *erd_ev;
+    Evaluator_mpf *mpf_ev;
+    Evaluator_mpfi *mpfi_ev;
 
 public:
 
-    Evaluator_combo(Egraph *egraph, Egraph_weights *weights, double target_precision, int bit_precision, int instrument);
+    Evaluator_combo(Egraph *egraph, Egraph_weights *weights, double target_precision, int bit_precision, int instrument,
+		    bool use_crt = false, bool race = false, bool recover = false);
+    ~Evaluator_combo();
+    // Use new weights for the next evaluation.  Resets statistics
+    void rebind(Egraph_weights *weights, int bit_precision);
     // literal_weights == NULL for unweighted
     void evaluate(mpf_class &count, bool no_mpq);
 
@@ -325,16 +787,65 @@ public:
     double guaranteed_precision;
     size_t max_bytes;
     int used_bit_precision() { return bit_precision; }
+    // Checkpoint any MPQ evaluation.  See Evaluator_mpq::set_checkpoint
+    void set_checkpoint(const char *fname, bool resume, double min_interval)
+    { checkpoint_name = fname; checkpoint_resume = resume; checkpoint_interval = min_interval; }
     // Leftover stuff that can be reused
     // Times for different evaluations.  Set to 0.0 if not used
     double erd_seconds;
+    double erdd_seconds;
+    double erld_seconds;
+    double erdi_seconds;
+    double mixed_seconds;
     double mpf_seconds;
     double mpfi_seconds;
     double mpq_seconds;
+    double crt_seconds;
+    double local_seconds;
+    double recover_seconds;
+    double unweighted_seconds;
+    // Exact count, computed with either MPQ or CRT
     mpq_class mpq_count;
     mpf_class mpf_count;
     mpf_class erd_count;
+    mpf_class erdd_count;
+    mpf_class erld_count;
+    mpf_class erdi_count;
+    double erdi_precision;
+    mpf_class mixed_count;
+    double mixed_precision;
     mpfi_t mpfi_count;
     double min_digit_precision;
+
+private:
+    // Checkpointing of MPQ evaluation
+    const char *checkpoint_name;
+    bool checkpoint_resume;
+    double checkpoint_interval;
+    // Clear results and statistics
+    void reset();
+    // Compute exact value with MPQ or CRT
+    void evaluate_exact(mpf_class &count);
+    // Compute exact value into mpq_count.  Return false if cancelled
+    bool compute_exact(const std::atomic<bool> *cancel);
+    // Set count and statistics from exact value
+    void finish_exact(mpf_class &count);
+    // Relative error of floating-point evaluation with nonnegative weights is at most error_factor * 2^-bit_precision
+    double error_factor;
+    // Error factor for ERD with compensated summation
+    double erd_error_factor;
+    // Size of exact result
+    size_t exact_bytes;
+    // Method used to compute exact value
+    computed_t exact_method;
+    // Compute exact value into mpq_count by rounding MPFI result scaled by denominator bound.
+    // Return false if not possible with reasonable precision
+    bool recover_exact(const std::atomic<bool> *cancel);
+    // Recompute operations that lose precision exactly, and then repeat MPFI.  Return false if unsuccessful
+    bool evaluate_local(mpf_class &count);
+
+    // Not copyable
+    Evaluator_combo(const Evaluator_combo &);
+    Evaluator_combo& operator=(const Evaluator_combo &);
 };
 
@@ -32,18 +32,35 @@
 #include <unistd.h>
 #include <cstring>
 #include <ctype.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 
 #include "cnf_info.hh"
 #include "egraph.hh"
+#include "shared_graph.hh"
 #include "counters.h"
 #include "report.h"
 #include "analysis.h"
+#include "decompress.h"
 
 void usage(const char *name) {
-    lprintf("Usage: %s [-h] [-s] [-I] [-v VERB] [-L LEVEL] [-p PREC] [-b BPREC] [-o OUT.nnf] FORMULA.nnf FORMULA_1.cnf ... FORMULA_k.cnf\n", name);
+    lprintf("Usage: %s [-h] [-s] [-E] [-I] [-m] [-r] [-x] [-v VERB] [-L LEVEL] [-p PREC] [-b BPREC] [-t THREADS] [-M] [-K SECS] [-R] [-C DIR] [-c MODE] [-o OUT.nnf] FORMULA.nnf FORMULA_1.cnf ... FORMULA_k.cnf\n", name);
+    lprintf("       %s [options] -S SOCKET F_1.nnf F_1.cnf ... F_k.nnf F_k.cnf\n", name);
+    lprintf("       %s [options] [-G MB] -J MANIFEST\n", name);
     lprintf("  -h          Print this information\n");
     lprintf("  -s          Use smoothing, rather than ring evaluation\n");
+    lprintf("  -E          Evaluate while reading NNF, without building graph.  Single CNF file.  Use '-' for NNF from stdin\n");
     lprintf("  -I          Measure digit precision of MPFI intermediate results\n");
+    lprintf("  -m          Use multi-modular (CRT) arithmetic rather than MPQ for exact evaluation\n");
+    lprintf("  -r          Race exact evaluation against MPFI on separate threads\n");
+    lprintf("  -x          Recover exact count from high-precision MPFI using bound on its denominator\n");
     lprintf("  -v VERB     Set verbosity level\n");
     lprintf("  -L LEVEL Detail level:\n");
     lprintf("           0: Basic+Don't attempt MPQ\n");
@@ -53,12 +70,23 @@ void usage(const char *name) {
     lprintf("           4: + Q25\n");
     lprintf("  -p PREC     Required precision (in decimal digits)\n");
     lprintf("  -b BPREC    Fix bit precision (should be multiple of 64)\n");
+    lprintf("  -t THREADS  Evaluate weight files concurrently with THREADS threads\n");
+    lprintf("  -M          Share parsed graph with other nnfcount processes through shared memory\n");
+    lprintf("  -K SECS     Checkpoint MPQ evaluation to FORMULA_i.mpqck at least SECS seconds apart\n");
+    lprintf("  -R          Resume MPQ evaluation from checkpoint file\n");
+    lprintf("  -C DIR      Cache combo results in directory DIR\n");
+    lprintf("  -c MODE     Cache mode: r (lookup only), w (populate only), rw (lookup and populate)\n");
     lprintf("  -o OUT.nnf  Save copy of formula (including possible smoothing)\n");
+    lprintf("  -S SOCKET   Load formulas and serve count requests on Unix domain socket SOCKET\n");
+    lprintf("  -J MANIFEST Run jobs listed in MANIFEST, one per line: [-s] [-p PREC] [-L LEVEL] [-b BPREC] FORMULA.nnf FORMULA_1.cnf ...\n");
+    lprintf("  -G MB       Memory limit (in megabytes) for jobs run concurrently.  Default is available memory\n");
+    lprintf("  Input files may be compressed with gzip or zstd\n");
 
 }
 
 #define BUFLEN 1024
-char namebuf[BUFLEN];
+// Worker threads generate names concurrently
+thread_local char namebuf[BUFLEN];
 
 char *change_extension(const char *fname, const char *ext) {
     strncpy(namebuf, fname, BUFLEN-1);
@@ -71,6 +99,11 @@ char *change_extension(const char *fname, const char *ext) {
     int rpos = strnlen(namebuf, BUFLEN)-1;
     for (; rpos > lpos && namebuf[rpos] != '.'; rpos--)
 	;
+    /* Compression suffix */
+    if (rpos > lpos && (strcmp(&namebuf[rpos], ".gz") == 0 || strcmp(&namebuf[rpos], ".zst") == 0)) {
+	for (rpos--; rpos > lpos && namebuf[rpos] != '.'; rpos--)
+	    ;
+    }
     if (rpos > lpos)
 	namebuf[rpos] = 0;
     strncpy(&namebuf[rpos], ext, 10);
@@ -78,45 +111,113 @@ char *change_extension(const char *fname, const char *ext) {
 }
 
 const char *prefix = "c: CNT:";
-bool smooth = false;
-int detail_level = 1;
+// Each worker thread has its own formula, options, evaluator, and precision
+thread_local bool smooth = false;
+thread_local int detail_level = 1;
 bool instrument = false;
-double target_precision = 30.0;
-int bit_precision = 0;
-int mpf_precision = 128;
-Egraph *eg;
-Cnf *core_cnf = NULL;
-Evaluator_combo *combo_ev = NULL;
-double setup_time = 0;
-double smooth_time = 0;
-
-void setup(FILE *cnf_file, FILE *nnf_file, FILE *out_file) {
+bool use_crt = false;
+bool race = false;
+bool recover = false;
+bool stream = false;
+thread_local double target_precision = 30.0;
+thread_local int bit_precision = 0;
+thread_local int mpf_precision = 128;
+int thread_count = 1;
+thread_local Egraph *eg;
+thread_local Cnf *core_cnf = NULL;
+thread_local Evaluator_combo *combo_ev = NULL;
+thread_local Egraph_weights *combo_weights = NULL;
+thread_local double setup_time = 0;
+thread_local double smooth_time = 0;
+// Result cache
+const char *cache_dir = NULL;
+bool cache_read = true;
+bool cache_write = true;
+thread_local uint64_t graph_hash = 0;
+// Checkpointing of MPQ evaluation.  Disabled when interval is 0
+double checkpoint_interval = 0;
+bool checkpoint_resume = false;
+// Place graph in shared memory
+bool share_graph = false;
+// NNF file being read by setup
+FILE *setup_nnf_file = NULL;
+
+// Per-thread state, copied from the thread that starts a worker
+struct Eval_settings {
+    Egraph *eg;
+    Cnf *core_cnf;
+    double setup_time;
+    double smooth_time;
+    uint64_t graph_hash;
+    bool smooth;
+    int detail_level;
+    double target_precision;
+    int bit_precision;
+    int mpf_precision;
+};
+
+Eval_settings get_settings() {
+    return {eg, core_cnf, setup_time, smooth_time, graph_hash, smooth, detail_level, target_precision, bit_precision,
+	    mpf_precision};
+}
+
+void use_settings(const Eval_settings &settings) {
+    eg = settings.eg;
+    core_cnf = settings.core_cnf;
+    setup_time = settings.setup_time;
+    smooth_time = settings.smooth_time;
+    graph_hash = settings.graph_hash;
+    smooth = settings.smooth;
+    detail_level = settings.detail_level;
+    target_precision = settings.target_precision;
+    bit_precision = settings.bit_precision;
+    mpf_precision = settings.mpf_precision;
+}
+
+Egraph *build_graph(std::unordered_set<int> *data_variables) {
+    Egraph *graph = new Egraph(data_variables, core_cnf->variable_count());
+    graph->read_nnf(setup_nnf_file);
+    if (smooth) {
+	double start_smooth =  tod();	
+	graph->smooth();
+	smooth_time = tod() - start_smooth;
+    }
+    return graph;
+}
+
+// Build graph from NNF file, or attach to shared copy.  Uses core_cnf
+void load_graph(const char *nnf_name, FILE *nnf_file) {
+    smooth_time = 0;
+    setup_nnf_file = nnf_file;
+    if (share_graph)
+	eg = share_egraph(nnf_name, core_cnf->data_variables, core_cnf->variable_count(), smooth, build_graph);
+    else
+	eg = build_graph(core_cnf->data_variables);
+}
+
+void setup(const char *nnf_name, FILE *cnf_file, FILE *nnf_file, FILE *out_file) {
     double start_time = tod();
     core_cnf = new Cnf();
     core_cnf->import_file(cnf_file, true, false);
 
     if (bit_precision == 0)
 	mpf_precision = required_bit_precision(target_precision, core_cnf->variable_count(), 5, false);
+    // Only sets precision of temporaries.  Evaluators are given their precision explicitly
     mpf_set_default_prec(mpf_precision);
     mpfr_set_default_prec(mpf_precision);
 
 
-    eg = new Egraph(core_cnf->data_variables, core_cnf->variable_count());
-    eg->read_nnf(nnf_file);
-    if (smooth) {
-	double start_smooth =  tod();	
-	eg->smooth();
-	smooth_time = tod() - start_smooth;
-    } else
-	smooth_time = 0;
+    load_graph(nnf_name, nnf_file);
     setup_time = tod() - start_time;
+    if (cache_dir)
+	graph_hash = hash_graph(eg);
 
     if (out_file)
 	eg->write_nnf(out_file);
 }
 
 void run(const char *cnf_name) {
-    FILE *cnf_file = fopen(cnf_name, "r");
+    FILE *cnf_file = open_input(cnf_name);
     if (!cnf_file) {
 	err(false, "Couldn't open file '%s'.  Skipping\n", cnf_name);
 	return;
@@ -125,7 +226,7 @@ void run(const char *cnf_name) {
     double end_time;
     Cnf *local_cnf = new Cnf();
     local_cnf->import_file(cnf_file, true, false);
-    fclose(cnf_file);
+    close_input(cnf_file);
     
     std::unordered_map<int,const char*> *input_weights = NULL;
     const char *wlabel = "UNWEIGHTED";
@@ -134,7 +235,11 @@ void run(const char *cnf_name) {
 	wlabel = "WEIGHTED";
     }
 
-    q25_ptr wcount = q25_from_32(0);
+    // Q25 package is not thread safe
+    std::unique_lock<std::recursive_mutex> q25_guard(q25_lock, std::defer_lock);
+    if (detail_level >= 4)
+	q25_guard.lock();
+    q25_ptr wcount = NULL;
     mpq_class mpq_count = 0;
     if (detail_level >= 4) {
 	Evaluator_q25 qev = Evaluator_q25(eg);
@@ -169,6 +274,8 @@ void run(const char *cnf_name) {
     } else {
 	start_time = tod();
 	Evaluator_mpq mpqev = Evaluator_mpq(eg, weights);
+	if (checkpoint_interval > 0)
+	    mpqev.set_checkpoint(archive_string(change_extension(cnf_name, ".mpqck")), checkpoint_resume, checkpoint_interval);
 	mpqev.evaluate(mpq_count);
 	mpq_seconds = tod() - start_time;
 	max_bytes = mpqev.max_bytes;
@@ -190,7 +297,29 @@ void run(const char *cnf_name) {
     }
     lprintf("%s     MPQ required %.3f seconds, %d max bytes\n",
 	    prefix, mpq_seconds, max_bytes);
-    q25_free(wcount);
+    if (combo_ev && combo_ev->crt_seconds > 0) {
+	if (cmp(combo_ev->mpq_count, mpq_count) == 0)
+	    lprintf("%s   CRT weighted count == MPQ weighted count\n", prefix);
+	else
+	    err(false, "CRT weighted count != MPQ weighted count\n");
+	lprintf("%s     CRT required %.3f seconds\n", prefix, combo_ev->crt_seconds);
+    }
+    if (combo_ev && combo_ev->unweighted_seconds > 0) {
+	if (cmp(combo_ev->mpq_count, mpq_count) == 0)
+	    lprintf("%s   Integer count == MPQ count\n", prefix);
+	else
+	    err(false, "Integer count != MPQ count\n");
+	lprintf("%s     Integer evaluation required %.3f seconds\n", prefix, combo_ev->unweighted_seconds);
+    }
+    if (combo_ev && combo_ev->recover_seconds > 0) {
+	if (cmp(combo_ev->mpq_count, mpq_count) == 0)
+	    lprintf("%s   Recovered weighted count == MPQ weighted count\n", prefix);
+	else
+	    err(false, "Recovered weighted count != MPQ weighted count\n");
+	lprintf("%s     Recovery required %.3f seconds\n", prefix, combo_ev->recover_seconds);
+    }
+    if (wcount)
+	q25_free(wcount);
 
     double mpf_seconds = 0.0;
     mpf_class fcount = 0;
@@ -199,7 +328,7 @@ void run(const char *cnf_name) {
 	fcount = combo_ev->mpf_count;
     } else {
 	start_time = tod();
-	Evaluator_mpf mpfev = Evaluator_mpf(eg, weights);
+	Evaluator_mpf mpfev(eg, weights, mpf_precision);
 	mpfev.evaluate(fcount);
 	mpf_seconds = tod() - start_time;
     }
@@ -230,10 +359,116 @@ void run(const char *cnf_name) {
     lprintf("%s     ERD required %.3f seconds\n",
 	    prefix, erd_seconds);
 
+    start_time = tod();
+    Evaluator_double cdev = Evaluator_double(eg, weights);
+    cdev.set_compensated(true);
+    double cdwcount = cdev.evaluate();
+    end_time = tod();
+    double cwprecision = digit_precision_d(cdwcount, mpq_count.get_mpq_t());
+    lprintf("%s   %s DBLC COUNT   = %.20g   precision = %.3f\n", prefix, wlabel, cdwcount, cwprecision);
+    lprintf("%s     DBLC required %.3f seconds\n",
+	    prefix, end_time - start_time);
+
+    start_time = tod();
+    Evaluator_erd cerdev = Evaluator_erd(eg, weights);
+    cerdev.set_compensated(true);
+    mpf_class cerdcount = 0.0;
+    cerdev.evaluate(cerdcount);
+    end_time = tod();
+    double cerdprecision = digit_precision_mpf(cerdcount.get_mpf_t(), mpq_count.get_mpq_t());
+    const char *scecount = mpf_string(cerdcount.get_mpf_t(), (int) target_precision);
+    lprintf("%s   %s ERDC COUNT   = %s   precision = %.3f\n", prefix, wlabel, scecount, cerdprecision);
+    lprintf("%s     ERDC required %.3f seconds\n",
+	    prefix, end_time - start_time);
+
+    double erdd_seconds = 0.0;
+    mpf_class erddcount = 0.0;
+    if (combo_ev && combo_ev->erdd_seconds > 0) {
+	erdd_seconds = combo_ev->erdd_seconds;
+	erddcount = combo_ev->erdd_count;
+    } else {
+	start_time = tod();
+	Evaluator_erdd erddev = Evaluator_erdd(eg, weights);
+	erddev.evaluate(erddcount);
+	erdd_seconds = tod() - start_time;
+    }
+    double erddprecision = digit_precision_mpf(erddcount.get_mpf_t(), mpq_count.get_mpq_t());
+    const char *sddcount = mpf_string(erddcount.get_mpf_t(), (int) target_precision);
+    lprintf("%s   %s ERDD COUNT   = %s   precision = %.3f\n", prefix, wlabel, sddcount, erddprecision);
+    lprintf("%s     ERDD required %.3f seconds\n",
+	    prefix, erdd_seconds);
+
+    double erld_seconds = 0.0;
+    mpf_class erldcount = 0.0;
+    if (combo_ev && combo_ev->erld_seconds > 0) {
+	erld_seconds = combo_ev->erld_seconds;
+	erldcount = combo_ev->erld_count;
+    } else {
+	start_time = tod();
+	Evaluator_erld erldev = Evaluator_erld(eg, weights);
+	erldev.evaluate(erldcount);
+	erld_seconds = tod() - start_time;
+    }
+    double erldprecision = digit_precision_mpf(erldcount.get_mpf_t(), mpq_count.get_mpq_t());
+    const char *sldcount = mpf_string(erldcount.get_mpf_t(), (int) target_precision);
+    lprintf("%s   %s ERLD COUNT   = %s   precision = %.3f\n", prefix, wlabel, sldcount, erldprecision);
+    lprintf("%s     ERLD required %.3f seconds\n",
+	    prefix, erld_seconds);
+
+    double erdi_seconds = 0.0;
+    mpf_class erdicount = 0.0;
+    double erdi_est_precision = 0.0;
+    if (combo_ev && combo_ev->erdi_seconds > 0) {
+	erdi_seconds = combo_ev->erdi_seconds;
+	erdicount = combo_ev->erdi_count;
+	erdi_est_precision = combo_ev->erdi_precision;
+    } else {
+	start_time = tod();
+	Evaluator_erdi erdiev = Evaluator_erdi(eg, weights);
+	erdiev.evaluate(erdicount);
+	erdi_seconds = tod() - start_time;
+	erdi_est_precision = erdiev.digit_precision;
+    }
+    double erdiprecision = digit_precision_mpf(erdicount.get_mpf_t(), mpq_count.get_mpq_t());
+    const char *sicount_erdi = mpf_string(erdicount.get_mpf_t(), (int) target_precision);
+    lprintf("%s   %s ERDI COUNT   = %s   precision est = %.3f actual = %.3f\n", prefix, wlabel, sicount_erdi,
+	    erdi_est_precision, erdiprecision);
+    lprintf("%s     ERDI required %.3f seconds\n",
+	    prefix, erdi_seconds);
+
+    double mixed_seconds = 0.0;
+    mpf_class mixedcount = 0.0;
+    double mixed_est_precision = 0.0;
+    if (combo_ev && combo_ev->mixed_seconds > 0) {
+	mixed_seconds = combo_ev->mixed_seconds;
+	mixedcount = combo_ev->mixed_count;
+	mixed_est_precision = combo_ev->mixed_precision;
+    } else {
+	start_time = tod();
+	Evaluator_mixed mixedev(eg, weights, mpf_precision);
+	mpfi_t mixed_interval;
+	mpfi_init2(mixed_interval, mpf_precision);
+	mixedev.evaluate(mixed_interval);
+	mixed_seconds = tod() - start_time;
+	mixed_est_precision = digit_precision_mpfi(mixed_interval);
+	mpfr_t mixed_mid;
+	mpfr_init2(mixed_mid, mpf_precision);
+	mpfi_mid(mixed_mid, mixed_interval);
+	mpfr_get_f(mixedcount.get_mpf_t(), mixed_mid, MPFR_RNDN);
+	mpfr_clear(mixed_mid);
+	mpfi_clear(mixed_interval);
+    }
+    double mixedprecision = digit_precision_mpf(mixedcount.get_mpf_t(), mpq_count.get_mpq_t());
+    const char *smixedcount = mpf_string(mixedcount.get_mpf_t(), (int) target_precision);
+    lprintf("%s   %s MIXED COUNT  = %s   precision est = %.3f actual = %.3f\n", prefix, wlabel, smixedcount,
+	    mixed_est_precision, mixedprecision);
+    lprintf("%s     MIXED required %.3f seconds\n",
+	    prefix, mixed_seconds);
+
     double mpfi_seconds = 0.0;
     mpfi_t mpfi_count;
     double min_digit_precision = 0.0;
-    mpfi_init(mpfi_count);
+    mpfi_init2(mpfi_count, mpf_precision);
     mpfi_set_d(mpfi_count, 0.0);
     if (combo_ev && combo_ev->mpfi_seconds > 0) {
 	mpfi_seconds = combo_ev->mpfi_seconds;
@@ -241,14 +476,14 @@ void run(const char *cnf_name) {
 	min_digit_precision = combo_ev->min_digit_precision;
     } else {
 	start_time = tod();
-	Evaluator_mpfi mpfiev = Evaluator_mpfi(eg, weights, instrument);
+	Evaluator_mpfi mpfiev(eg, weights, instrument, mpf_precision);
 	mpfiev.evaluate(mpfi_count);
 	mpfi_seconds = tod() - start_time;
 	min_digit_precision = mpfiev.min_digit_precision;
     }
     double est_precision = digit_precision_mpfi(mpfi_count);
     mpfr_t mid;
-    mpfr_init(mid);
+    mpfr_init2(mid, mpf_precision);
     mpfi_mid(mid, mpfi_count);
     double actual_precision = digit_precision_mpfr(mid, mpq_count.get_mpq_t());
     const char *sicount = mpfr_string(mid, (int) target_precision);
@@ -264,8 +499,53 @@ void run(const char *cnf_name) {
     delete local_cnf;
 }
 
+/*
+  Result cache.  One file per combination of graph, weights, and options,
+  holding the combo count, method, guaranteed precision, and bit precision
+*/
+
+void cache_file_name(char *buf, int len, Egraph_weights *weights) {
+    uint64_t h = hash_weights(eg, weights);
+    char options[BUFLEN];
+    snprintf(options, BUFLEN, "%g %d %d %d %d %d %d", target_precision, bit_precision,
+	     (int) (detail_level <= 1), instrument, use_crt, race, recover);
+    uint64_t oh = hash_string(options);
+    snprintf(buf, len, "%s/%016llx-%016llx-%016llx.wmc", cache_dir,
+	     (unsigned long long) graph_hash, (unsigned long long) h, (unsigned long long) oh);
+}
+
+// Return true if found.  Count string is allocated with malloc
+bool cache_lookup(const char *fname, char **scount, char *method, double *precision, int *bits) {
+    FILE *infile = fopen(fname, "r");
+    if (!infile)
+	return false;
+    char sbuf[BUFLEN];
+    bool found = fscanf(infile, "%1023s %63s %lf %d", sbuf, method, precision, bits) == 4;
+    fclose(infile);
+    if (found)
+	*scount = strdup(sbuf);
+    return found;
+}
+
+// Write to temporary file and rename, so that concurrent readers never see partial entry
+void cache_store(const char *fname, const char *scount, const char *method, double precision, int bits) {
+    char tname[BUFLEN];
+    snprintf(tname, BUFLEN, "%s.%d.%lx", fname, (int) getpid(), (unsigned long) pthread_self());
+    FILE *outfile = fopen(tname, "w");
+    if (!outfile) {
+	err(false, "Couldn't write cache file '%s'\n", tname);
+	return;
+    }
+    fprintf(outfile, "%s %s %.3f %d\n", scount, method, precision, bits);
+    fclose(outfile);
+    if (rename(tname, fname) != 0) {
+	err(false, "Couldn't rename cache file '%s'\n", tname);
+	unlink(tname);
+    }
+}
+
 void run_combo(const char *cnf_name) {
-    FILE *cnf_file = fopen(cnf_name, "r");
+    FILE *cnf_file = open_input(cnf_name);
     if (!cnf_file) {
 	err(false, "Couldn't open file '%s'.  Skipping\n", cnf_name);
 	return;
@@ -280,7 +560,7 @@ void run_combo(const char *cnf_name) {
     lprintf("%s     Using weights from file '%s'\n", prefix, cnf_name);
     Cnf *local_cnf = new Cnf();
     local_cnf->import_file(cnf_file, true, false);
-    fclose(cnf_file);
+    close_input(cnf_file);
     
     std::unordered_map<int,const char*> *input_weights = NULL;
     const char *wlabel = "UNWEIGHTED";
@@ -295,15 +575,42 @@ void run_combo(const char *cnf_name) {
 	return;
     }
     mpf_class ccount = 0.0;
-    combo_ev = new Evaluator_combo(eg, weights, target_precision, bit_precision, instrument);
-    bool abort_mpq = detail_level <= 1;
-    combo_ev->evaluate(ccount, abort_mpq);
-    double precision = combo_ev->guaranteed_precision;
-    bit_precision = combo_ev->used_bit_precision();
-    const char *sccount = mpf_string(ccount.get_mpf_t(), (int) target_precision);
-    lprintf("%s    COMBO COUNT    = %s  guaranteed precision = %.3f\n", prefix, sccount,precision);
-    lprintf("%s      COMBO used %s with %.3f seconds and %d max bytes\n",
-	    prefix, combo_ev->method(), tod() - start_time, combo_ev->max_bytes);
+    // Evaluator is reused for all weight files
+    if (combo_ev) {
+	combo_ev->rebind(weights, bit_precision);
+	delete combo_weights;
+    } else
+	combo_ev = new Evaluator_combo(eg, weights, target_precision, bit_precision, instrument, use_crt, race, recover);
+    combo_weights = weights;
+    if (checkpoint_interval > 0)
+	combo_ev->set_checkpoint(archive_string(change_extension(cnf_name, ".mpqck")), checkpoint_resume, checkpoint_interval);
+    char cache_name[BUFLEN];
+    char cached_method[64];
+    char *sccount = NULL;
+    double precision = 0.0;
+    if (cache_dir)
+	cache_file_name(cache_name, BUFLEN, weights);
+    if (cache_dir && cache_read &&
+	cache_lookup(cache_name, &sccount, cached_method, &precision, &bit_precision)) {
+	ccount.set_str(sccount, 10);
+	lprintf("%s    COMBO COUNT    = %s  guaranteed precision = %.3f\n", prefix, sccount, precision);
+	lprintf("%s      COMBO cache hit (%s) in '%s' with %.3f seconds\n",
+		prefix, cached_method, cache_name, tod() - start_time);
+    } else {
+	bool abort_mpq = detail_level <= 1;
+	combo_ev->evaluate(ccount, abort_mpq);
+	precision = combo_ev->guaranteed_precision;
+	bit_precision = combo_ev->used_bit_precision();
+	sccount = (char *) mpf_string(ccount.get_mpf_t(), (int) target_precision);
+	lprintf("%s    COMBO COUNT    = %s  guaranteed precision = %.3f\n", prefix, sccount,precision);
+	lprintf("%s      COMBO used %s with %.3f seconds and %d max bytes\n",
+		prefix, combo_ev->method(), tod() - start_time, combo_ev->max_bytes);
+	if (cache_dir && cache_write) {
+	    cache_store(cache_name, sccount, combo_ev->method(), precision, bit_precision);
+	    report(1, "Saved result in cache file '%s'\n", cache_name);
+	}
+    }
+    free(sccount);
 
     if (detail_level == 1) {
 	start_time = tod();
@@ -349,8 +656,11 @@ void report_stats() {
     lprintf("%s     Digit precision : %.1f\n", prefix, target_precision);
     lprintf("%s     Bit precision   : %d\n", prefix, bit_precision);
     lprintf("%s   Data variables    : %d\n", prefix, ndvar);
-    lprintf("%s     Smooth variables: %d\n", prefix, eg->smooth_variable_count);
-    lprintf("%s   Disabled edges    : %d\n", prefix, eg->disabled_edge_count);
+    // Variables with zero weight sum are counted as smoothed
+    int zero_count = combo_weights ? combo_weights->zero_variable_count : 0;
+    int disabled_count = combo_weights ? combo_weights->disabled_edge_count : 0;
+    lprintf("%s     Smooth variables: %d\n", prefix, eg->smooth_variable_count + zero_count);
+    lprintf("%s   Disabled edges    : %d\n", prefix, disabled_count);
     lprintf("%s   Operations \n", prefix);
     lprintf("%s     Sums            : %d\n", prefix, sum_count);
     lprintf("%s     Edge products   : %d\n", prefix, edge_product_count);
@@ -367,10 +677,703 @@ void report_stats() {
 	    sum_count + node_product_count + 8 * edge_product_count + 4 * edge_product_ops + 4 * smoothing_ops);
 }
 
+/*
+  One-shot evaluation while reading the NNF file.  Weights are prepared first, so that
+  the graph never needs to be stored
+*/
+bool run_stream(const char *nnf_name, const char *cnf_name) {
+    double start_time = tod();
+    FILE *cnf_file = open_input(cnf_name);
+    if (!cnf_file) {
+	err(false, "Couldn't open CNF file '%s'\n", cnf_name);
+	return false;
+    }
+    char *lname = change_extension(cnf_name, ".count");
+    lprintf("%s Saving results in '%s'\n", prefix, lname);
+    set_logname(lname);
+    core_cnf = new Cnf();
+    bool ok = core_cnf->import_file(cnf_file, true, false);
+    close_input(cnf_file);
+    if (!ok)
+	return false;
+    int nvar = core_cnf->variable_count();
+    if (bit_precision == 0)
+	bit_precision = required_bit_precision(target_precision, nvar, 5, false);
+    mpf_set_default_prec(bit_precision);
+    mpfr_set_default_prec(bit_precision);
+    // Graph without edges, used only to prepare the weights
+    Egraph weight_graph(core_cnf->data_variables, nvar);
+    Egraph_weights *weights = weight_graph.prepare_weights(core_cnf->is_weighted() ? core_cnf->input_weights : NULL);
+    if (!weights)
+	return false;
+    if (weights->smoothing_weights.size() > 0) {
+	err(false, "Variables with zero weight sum can't be handled while streaming\n");
+	delete weights;
+	return false;
+    }
+    lprintf("%s     Using weights from file '%s'\n", prefix, cnf_name);
+    FILE *nnf_file = open_input(nnf_name);
+    if (!nnf_file) {
+	err(false, "Couldn't open NNF file '%s'\n", nnf_name);
+	delete weights;
+	return false;
+    }
+    Evaluator_stream sev(nvar, weights, bit_precision);
+    mpfi_t count;
+    mpfi_init2(count, bit_precision);
+    ok = sev.evaluate(nnf_file, count);
+    close_input(nnf_file);
+    if (ok) {
+	double precision = digit_precision_mpfi(count);
+	mpfr_t mid;
+	mpfr_init2(mid, bit_precision);
+	mpfi_mid(mid, count);
+	const char *scount = mpfr_string(mid, (int) target_precision);
+	lprintf("%s    STREAM COUNT   = %s  guaranteed precision = %.3f\n", prefix, scount, precision);
+	lprintf("%s      STREAM used MPFI with %d bits and %.3f seconds\n", prefix, bit_precision, tod() - start_time);
+	lprintf("%s      STREAM read %d operations and %ld edges.  Allocated %d values\n",
+		prefix, sev.operation_count, sev.edge_count, sev.allocated_values);
+	if (precision < target_precision)
+	    err(false, "Streaming evaluation did not achieve target precision.  Try larger bit precision or nonstreaming evaluation\n");
+	mpfr_clear(mid);
+    }
+    mpfi_clear(count);
+    delete weights;
+    set_logname(NULL);
+    return ok;
+}
+
+/*
+  Concurrent evaluation of weight files.  Each worker thread takes the next file,
+  with output captured in a buffer.  Buffers are printed in command-line order
+*/
+
+struct Weight_job {
+    const char *cnf_name;
+    const char *log_name;
+    char *output;
+    size_t output_length;
+    bool done;
+};
+
+// Local to run_parallel, so that a fatal error on a worker doesn't destroy it during exit
+struct Job_pool {
+    std::vector<Weight_job> jobs;
+    std::atomic<int> next_job;
+    std::mutex lock;
+    std::condition_variable job_done;
+    // Statistics for graph, used to initialize those for each job
+    counter_set_t graph_counters;
+    Eval_settings settings;
+};
+
+void run_job(Job_pool *pool, Weight_job &job) {
+    FILE *out = open_memstream(&job.output, &job.output_length);
+    set_thread_output(out);
+    lprintf("\n");
+    lprintf("%s Saving results in '%s'\n", prefix, job.log_name);
+    set_thread_logname(job.log_name);
+    run_combo(job.cnf_name);
+    if (detail_level >= 3)
+	run(job.cnf_name);
+    report_stats();
+    set_thread_logname(NULL);
+    set_thread_output(NULL);
+    fclose(out);
+    std::lock_guard<std::mutex> guard(pool->lock);
+    job.done = true;
+    pool->job_done.notify_all();
+}
+
+void run_worker(Job_pool *pool) {
+    use_settings(pool->settings);
+    mpfr_set_default_prec(mpf_precision);
+    counter_set_t counters;
+    set_thread_counters(&counters);
+    while (true) {
+	int j = pool->next_job++;
+	if (j >= pool->jobs.size())
+	    break;
+	// Results for a file must not depend on which files the thread handled before
+	use_settings(pool->settings);
+	counters = pool->graph_counters;
+	run_job(pool, pool->jobs[j]);
+    }
+    set_thread_counters(NULL);
+    delete combo_ev;
+    delete combo_weights;
+    combo_ev = NULL;
+    combo_weights = NULL;
+}
+
+void run_parallel(int argi, int argc, char *argv[]) {
+    Job_pool pool;
+    for (; argi < argc; argi++) {
+	const char *cnf_name = argv[argi];
+	const char *lname = archive_string(change_extension(cnf_name, smooth ? ".scount" : ".count"));
+	pool.jobs.push_back({cnf_name, lname, NULL, 0, false});
+    }
+    pool.next_job = 0;
+    pool.settings = get_settings();
+    copy_global_counters(&pool.graph_counters);
+    int nthread = thread_count < pool.jobs.size() ? thread_count : pool.jobs.size();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nthread; t++)
+	workers.push_back(std::thread(run_worker, &pool));
+    for (Weight_job &job : pool.jobs) {
+	std::unique_lock<std::mutex> guard(pool.lock);
+	pool.job_done.wait(guard, [&job] { return job.done; });
+	guard.unlock();
+	fwrite(job.output, 1, job.output_length, stdout);
+	fflush(stdout);
+	free(job.output);
+	job.output = NULL;
+    }
+    for (std::thread &w : workers)
+	w.join();
+}
+
+/*
+  Server mode.  Load one or more formulas and then answer count requests
+  on a Unix domain socket.  Each request and response is a single line:
+    COUNT NAME FILE.cnf                  Weights from CNF file
+    COUNT NAME INLINE LIT WT ... LIT WT  Weights as literal/weight pairs (none for unweighted)
+    QUIT                                 Shut down the server
+  Responses:
+    OK count=COUNT method=METHOD precision=DIGITS bits=BPREC weight_seconds=SECS eval_seconds=SECS
+    ERROR MESSAGE
+  Formula NAME is the NNF file name without directory or extension.
+  Requests on different formulas are processed concurrently.  Those on the same formula are serialized
+*/
+
+struct Served_formula {
+    const char *name;
+    Egraph *eg;
+    double setup_seconds;
+    // Evaluator and its weights are reused across requests
+    std::mutex lock;
+    Evaluator_combo *combo;
+    Egraph_weights *weights;
+};
+
+struct Server {
+    std::vector<Served_formula *> formulas;
+    int listen_fd;
+    Eval_settings settings;
+    std::atomic<bool> quit;
+};
+
+Served_formula *find_formula(Server *server, const char *name) {
+    for (Served_formula *f : server->formulas)
+	if (strcmp(f->name, name) == 0)
+	    return f;
+    return NULL;
+}
+
+// Evaluate request tokens following COUNT.  Fill buffer with response
+void serve_count(Server *server, char *saveptr, char *response, int rlen) {
+    const char *name = strtok_r(NULL, " \t\r\n", &saveptr);
+    const char *source = strtok_r(NULL, " \t\r\n", &saveptr);
+    if (!name || !source) {
+	snprintf(response, rlen, "ERROR COUNT requires formula name and weight source\n");
+	return;
+    }
+    Served_formula *f = find_formula(server, name);
+    if (!f) {
+	snprintf(response, rlen, "ERROR Unknown formula '%s'\n", name);
+	return;
+    }
+    double start_time = tod();
+    Cnf *local_cnf = NULL;
+    std::unordered_map<int,const char*> inline_weights;
+    std::unordered_map<int,const char*> *input_weights = NULL;
+    if (strcmp(source, "INLINE") == 0) {
+	const char *slit;
+	while ((slit = strtok_r(NULL, " \t\r\n", &saveptr)) != NULL) {
+	    const char *swt = strtok_r(NULL, " \t\r\n", &saveptr);
+	    int lit = atoi(slit);
+	    if (!swt || lit == 0) {
+		snprintf(response, rlen, "ERROR Invalid literal/weight pair starting with '%s'\n", slit);
+		return;
+	    }
+	    inline_weights[lit] = swt;
+	}
+	if (inline_weights.size() > 0)
+	    input_weights = &inline_weights;
+    } else {
+	FILE *cnf_file = open_input(source);
+	if (!cnf_file) {
+	    snprintf(response, rlen, "ERROR Couldn't open file '%s'\n", source);
+	    return;
+	}
+	local_cnf = new Cnf();
+	bool ok = local_cnf->import_file(cnf_file, true, false);
+	close_input(cnf_file);
+	if (!ok) {
+	    snprintf(response, rlen, "ERROR Couldn't read CNF file '%s'\n", source);
+	    delete local_cnf;
+	    return;
+	}
+	if (local_cnf->is_weighted())
+	    input_weights = local_cnf->input_weights;
+    }
+
+    std::lock_guard<std::mutex> guard(f->lock);
+    Egraph_weights *weights = f->eg->prepare_weights(input_weights);
+    delete local_cnf;
+    if (weights == NULL) {
+	snprintf(response, rlen, "ERROR Invalid weights\n");
+	return;
+    }
+    double weight_seconds = tod() - start_time;
+    start_time = tod();
+    if (f->combo) {
+	f->combo->rebind(weights, server->settings.bit_precision);
+	delete f->weights;
+    } else
+	f->combo = new Evaluator_combo(f->eg, weights, target_precision, server->settings.bit_precision,
+				       instrument, use_crt, race, recover);
+    f->weights = weights;
+    mpf_class ccount = 0.0;
+    f->combo->evaluate(ccount, detail_level <= 1);
+    double eval_seconds = tod() - start_time;
+    const char *sccount = mpf_string(ccount.get_mpf_t(), (int) target_precision);
+    snprintf(response, rlen, "OK count=%s method=%s precision=%.3f bits=%d weight_seconds=%.3f eval_seconds=%.3f\n",
+	     sccount, f->combo->method(), f->combo->guaranteed_precision, f->combo->used_bit_precision(),
+	     weight_seconds, eval_seconds);
+    free((void *) sccount);
+}
+
+void serve_connection(Server *server, int fd) {
+    use_settings(server->settings);
+    mpfr_set_default_prec(mpf_precision);
+    counter_set_t counters;
+    init_counter_set(&counters);
+    set_thread_counters(&counters);
+    FILE *in = fdopen(fd, "r");
+    char *line = NULL;
+    size_t len = 0;
+    char response[BUFLEN];
+    while (!server->quit && getline(&line, &len, in) > 0) {
+	char *saveptr = NULL;
+	const char *cmd = strtok_r(line, " \t\r\n", &saveptr);
+	if (!cmd)
+	    continue;
+	double start_time = tod();
+	bool quit = false;
+	if (strcmp(cmd, "COUNT") == 0)
+	    serve_count(server, saveptr, response, BUFLEN);
+	else if (strcmp(cmd, "QUIT") == 0) {
+	    snprintf(response, BUFLEN, "OK\n");
+	    quit = true;
+	} else
+	    snprintf(response, BUFLEN, "ERROR Unknown request '%s'\n", cmd);
+	report(2, "Request '%s' completed in %.3f seconds: %s", cmd, tod() - start_time, response);
+	if (send(fd, response, strlen(response), MSG_NOSIGNAL) < 0)
+	    break;
+	if (quit) {
+	    // Wakes up main thread blocked in accept
+	    server->quit = true;
+	    shutdown(server->listen_fd, SHUT_RDWR);
+	}
+    }
+    free(line);
+    fclose(in);
+    set_thread_counters(NULL);
+}
+
+void run_server(const char *socket_name, int argi, int argc, char *argv[], FILE *out_file) {
+    Server server;
+    server.quit = false;
+    int max_mpf_precision = mpf_precision;
+    for (; argi + 1 < argc; argi += 2) {
+	const char *nnf_name = argv[argi];
+	const char *cnf_name = argv[argi+1];
+	FILE *nnf_file = open_input(nnf_name);
+	if (!nnf_file)
+	    err(true, "Couldn't open NNF file '%s'\n", nnf_name);
+	FILE *cnf_file = open_input(cnf_name);
+	if (!cnf_file)
+	    err(true, "Couldn't open CNF file '%s'\n", cnf_name);
+	setup(nnf_name, cnf_file, nnf_file, out_file);
+	close_input(nnf_file);
+	close_input(cnf_file);
+	Served_formula *f = new Served_formula;
+	f->name = archive_string(change_extension(nnf_name, ""));
+	if (find_formula(&server, f->name))
+	    err(true, "Duplicate formula name '%s'\n", f->name);
+	f->eg = eg;
+	f->setup_seconds = setup_time;
+	f->combo = NULL;
+	f->weights = NULL;
+	server.formulas.push_back(f);
+	if (mpf_precision > max_mpf_precision)
+	    max_mpf_precision = mpf_precision;
+	lprintf("%s Loaded formula '%s' in %.3f seconds\n", prefix, f->name, setup_time);
+	// Only the first formula is saved
+	out_file = NULL;
+    }
+    if (argi < argc)
+	err(true, "Server requires NNF/CNF file pairs\n");
+    mpf_precision = max_mpf_precision;
+    mpf_set_default_prec(mpf_precision);
+    mpfr_set_default_prec(mpf_precision);
+    server.settings = get_settings();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_name) >= sizeof(addr.sun_path))
+	err(true, "Socket name '%s' too long\n", socket_name);
+    strcpy(addr.sun_path, socket_name);
+    server.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server.listen_fd < 0)
+	err(true, "Couldn't create socket\n");
+    unlink(socket_name);
+    if (bind(server.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(server.listen_fd, 16) < 0)
+	err(true, "Couldn't listen on socket '%s'\n", socket_name);
+    lprintf("%s Serving %d formulas on socket '%s'\n", prefix, (int) server.formulas.size(), socket_name);
+    while (!server.quit) {
+	int fd = accept(server.listen_fd, NULL, NULL);
+	if (fd < 0)
+	    continue;
+	std::thread(serve_connection, &server, fd).detach();
+    }
+    close(server.listen_fd);
+    unlink(socket_name);
+    release_shared_egraphs();
+    lprintf("%s Server shut down\n", prefix);
+}
+
+/*
+  Batch mode.  Manifest file lists jobs, one per line:
+    [-s] [-p PREC] [-L LEVEL] [-b BPREC] FORMULA.nnf FORMULA_1.cnf ... FORMULA_k.cnf
+  Blank lines and those starting with '#' are ignored.
+  Each weight file becomes a task for a pool of worker threads, with results saved in its log file.
+  A task is only admitted once its estimated memory fits within the limit.
+  Formulas are loaded once and shared by all tasks that use them, and freed after the last one completes
+*/
+
+// Estimated ratio of graph size to NNF file size, used before the graph is loaded
+#define NNF_BYTES_FACTOR 4
+
+struct Batch_formula {
+    const char *nnf_name;
+    bool smooth;
+    // Weight file used to obtain data variables
+    const char *cnf_name;
+    Cnf *cnf;
+    Egraph *eg;
+    // Graph is in shared memory and must not be freed
+    bool shared;
+    double setup_time;
+    double smooth_time;
+    uint64_t graph_hash;
+    counter_set_t counters;
+    size_t bytes;
+    // Tasks not yet completed
+    int pending;
+};
+
+struct Batch_task {
+    Batch_formula *formula;
+    const char *cnf_name;
+    const char *log_name;
+    Eval_settings settings;
+    size_t bytes;
+};
+
+// Local to run_batch, so that a fatal error on a worker doesn't destroy it during exit
+struct Batch {
+    std::vector<Batch_formula *> formulas;
+    std::vector<Batch_task> tasks;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<Batch_task *> ready;
+    // Set once all tasks have been admitted
+    bool finished;
+    size_t memory_limit;
+    size_t memory_used;
+    // Tasks admitted but not completed
+    int active;
+};
+
+// Available memory from /proc/meminfo, or half of physical memory
+size_t available_memory() {
+    FILE *infile = fopen("/proc/meminfo", "r");
+    if (infile) {
+	char line[BUFLEN];
+	unsigned long kb;
+	while (fgets(line, BUFLEN, infile)) {
+	    if (sscanf(line, "MemAvailable: %lu kB", &kb) == 1) {
+		fclose(infile);
+		return (size_t) kb * 1024;
+	    }
+	}
+	fclose(infile);
+    }
+    return (size_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2;
+}
+
+Batch_formula *find_batch_formula(Batch *batch, const char *nnf_name, bool smooth) {
+    for (Batch_formula *f : batch->formulas)
+	if (f->smooth == smooth && strcmp(f->nnf_name, nnf_name) == 0)
+	    return f;
+    return NULL;
+}
+
+void read_manifest(Batch *batch, const char *manifest_name) {
+    FILE *infile = fopen(manifest_name, "r");
+    if (!infile)
+	err(true, "Couldn't open manifest file '%s'\n", manifest_name);
+    Eval_settings defaults = get_settings();
+    char *line = NULL;
+    size_t len = 0;
+    int line_number = 0;
+    while (getline(&line, &len, infile) > 0) {
+	line_number++;
+	char *saveptr = NULL;
+	char *tok = strtok_r(line, " \t\r\n", &saveptr);
+	if (!tok || tok[0] == '#')
+	    continue;
+	Eval_settings settings = defaults;
+	for (; tok && tok[0] == '-'; tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+	    char opt = tok[1];
+	    if (opt == 's') {
+		settings.smooth = true;
+		continue;
+	    }
+	    const char *val = strtok_r(NULL, " \t\r\n", &saveptr);
+	    if (!val)
+		err(true, "Manifest line %d: Option '%s' requires value\n", line_number, tok);
+	    if (opt == 'p')
+		settings.target_precision = atof(val);
+	    else if (opt == 'L')
+		settings.detail_level = atoi(val);
+	    else if (opt == 'b')
+		settings.bit_precision = atoi(val);
+	    else
+		err(true, "Manifest line %d: Unknown option '%s'\n", line_number, tok);
+	}
+	const char *nnf_name = tok ? archive_string(tok) : NULL;
+	tok = strtok_r(NULL, " \t\r\n", &saveptr);
+	if (!nnf_name || !tok)
+	    err(true, "Manifest line %d: Job requires NNF file and at least one CNF file\n", line_number);
+	Batch_formula *f = find_batch_formula(batch, nnf_name, settings.smooth);
+	if (!f) {
+	    f = new Batch_formula;
+	    memset(f, 0, sizeof(Batch_formula));
+	    f->nnf_name = nnf_name;
+	    f->smooth = settings.smooth;
+	    f->cnf_name = archive_string(tok);
+	    batch->formulas.push_back(f);
+	}
+	for (; tok; tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+	    const char *cnf_name = archive_string(tok);
+	    const char *lname = archive_string(change_extension(cnf_name, settings.smooth ? ".scount" : ".count"));
+	    f->pending++;
+	    batch->tasks.push_back({f, cnf_name, lname, settings, 0});
+	}
+    }
+    free(line);
+    fclose(infile);
+}
+
+// Read data variables for each formula and set the precision of temporaries to cover all tasks
+void prepare_formulas(Batch *batch) {
+    for (Batch_formula *f : batch->formulas) {
+	FILE *cnf_file = open_input(f->cnf_name);
+	if (!cnf_file)
+	    err(true, "Couldn't open CNF file '%s'\n", f->cnf_name);
+	// Statistics for reading the files are reported with those of each task
+	init_counter_set(&f->counters);
+	set_thread_counters(&f->counters);
+	f->cnf = new Cnf();
+	f->cnf->import_file(cnf_file, true, false);
+	set_thread_counters(NULL);
+	close_input(cnf_file);
+    }
+    // Temporaries are shared by all threads
+    int max_mpf_precision = mpf_precision;
+    for (Batch_task &task : batch->tasks) {
+	if (task.settings.bit_precision == 0)
+	    task.settings.mpf_precision =
+		required_bit_precision(task.settings.target_precision, task.formula->cnf->variable_count(), 5, false);
+	if (task.settings.mpf_precision > max_mpf_precision)
+	    max_mpf_precision = task.settings.mpf_precision;
+    }
+    mpf_set_default_prec(max_mpf_precision);
+    mpfr_set_default_prec(max_mpf_precision);
+}
+
+// Wait until there is room for an additional bytes of memory.  Always admits when nothing else is active
+void batch_admit(Batch *batch, size_t bytes, const char *name) {
+    std::unique_lock<std::mutex> guard(batch->lock);
+    if (batch->active > 0 && batch->memory_used + bytes > batch->memory_limit) {
+	report(2, "Waiting for %.1f MB of memory for '%s'.  %.1f MB in use by %d tasks\n",
+	       bytes / 1e6, name, batch->memory_used / 1e6, batch->active);
+	batch->changed.wait(guard, [batch, bytes]
+			    { return batch->active == 0 || batch->memory_used + bytes <= batch->memory_limit; });
+    }
+    if (batch->memory_used + bytes > batch->memory_limit)
+	report(1, "Running '%s' with estimated %.1f MB exceeds memory limit\n", name, bytes / 1e6);
+    batch->memory_used += bytes;
+}
+
+void load_batch_formula(Batch *batch, Batch_formula *f) {
+    struct stat sb;
+    size_t estimate = stat(f->nnf_name, &sb) == 0 ? (size_t) sb.st_size * NNF_BYTES_FACTOR : 0;
+    batch_admit(batch, estimate, f->nnf_name);
+    FILE *nnf_file = open_input(f->nnf_name);
+    if (!nnf_file)
+	err(true, "Couldn't open NNF file '%s'\n", f->nnf_name);
+    double start_time = tod();
+    set_thread_counters(&f->counters);
+    core_cnf = f->cnf;
+    smooth = f->smooth;
+    load_graph(f->nnf_name, nnf_file);
+    set_thread_counters(NULL);
+    close_input(nnf_file);
+    f->eg = eg;
+    f->shared = shared_egraph(eg);
+    f->setup_time = tod() - start_time;
+    f->smooth_time = smooth_time;
+    if (cache_dir)
+	f->graph_hash = hash_graph(eg);
+    f->bytes = graph_bytes(eg);
+    lprintf("%s Loaded formula '%s' in %.3f seconds\n", prefix, f->nnf_name, f->setup_time);
+    std::lock_guard<std::mutex> guard(batch->lock);
+    batch->memory_used += f->bytes;
+    batch->memory_used -= estimate;
+}
+
+// Estimate memory for evaluating weight file.  Every operation may hold an MPFI value and, when
+// exact evaluation is possible, an MPQ value of the predicted size
+size_t estimate_task_bytes(Batch_task *task) {
+    Egraph *graph = task->formula->eg;
+    int value_bytes = 2 * (32 + task->settings.mpf_precision / 8);
+    if (task->settings.detail_level >= 2) {
+	FILE *cnf_file = open_input(task->cnf_name);
+	if (!cnf_file)
+	    return 0;
+	Cnf *local_cnf = new Cnf();
+	local_cnf->import_file(cnf_file, true, true);
+	close_input(cnf_file);
+	Egraph_weights *weights = graph->prepare_weights(local_cnf->is_weighted() ? local_cnf->input_weights : NULL);
+	delete local_cnf;
+	if (!weights)
+	    return 0;
+	value_bytes += predict_mpq_bytes(graph, weights);
+	delete weights;
+    }
+    return graph->operations.size() * value_bytes + graph->edges.size();
+}
+
+void run_batch_worker(Batch *batch) {
+    counter_set_t counters;
+    set_thread_counters(&counters);
+    while (true) {
+	std::unique_lock<std::mutex> guard(batch->lock);
+	batch->changed.wait(guard, [batch] { return batch->finished || !batch->ready.empty(); });
+	if (batch->ready.empty())
+	    break;
+	Batch_task *task = batch->ready.front();
+	batch->ready.pop_front();
+	guard.unlock();
+
+	use_settings(task->settings);
+	mpfr_set_default_prec(mpf_precision);
+	counters = task->formula->counters;
+	char *output = NULL;
+	size_t output_length = 0;
+	FILE *out = open_memstream(&output, &output_length);
+	set_thread_output(out);
+	lprintf("\n");
+	lprintf("%s Saving results in '%s'\n", prefix, task->log_name);
+	set_thread_logname(task->log_name);
+	run_combo(task->cnf_name);
+	if (detail_level >= 3)
+	    run(task->cnf_name);
+	report_stats();
+	set_thread_logname(NULL);
+	set_thread_output(NULL);
+	fclose(out);
+	// Evaluator is not kept, since its formula may be freed
+	delete combo_ev;
+	delete combo_weights;
+	combo_ev = NULL;
+	combo_weights = NULL;
+
+	guard.lock();
+	fwrite(output, 1, output_length, stdout);
+	fflush(stdout);
+	free(output);
+	Batch_formula *f = task->formula;
+	batch->memory_used -= task->bytes;
+	batch->active--;
+	bool release = --f->pending == 0;
+	if (release)
+	    batch->memory_used -= f->bytes;
+	batch->changed.notify_all();
+	guard.unlock();
+	if (release) {
+	    if (!f->shared)
+		delete f->eg;
+	    delete f->cnf;
+	    f->eg = NULL;
+	    f->cnf = NULL;
+	}
+    }
+    set_thread_counters(NULL);
+}
+
+void run_batch(const char *manifest_name, size_t memory_limit) {
+    Batch batch;
+    batch.finished = false;
+    batch.memory_limit = memory_limit > 0 ? memory_limit : available_memory();
+    batch.memory_used = 0;
+    batch.active = 0;
+    read_manifest(&batch, manifest_name);
+    prepare_formulas(&batch);
+    lprintf("%s Running %d tasks on %d formulas with %d threads and %.1f MB memory limit\n", prefix,
+	    (int) batch.tasks.size(), (int) batch.formulas.size(), thread_count, batch.memory_limit / 1e6);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < thread_count; t++)
+	workers.push_back(std::thread(run_batch_worker, &batch));
+    for (Batch_task &task : batch.tasks) {
+	Batch_formula *f = task.formula;
+	if (!f->eg)
+	    load_batch_formula(&batch, f);
+	task.settings.eg = f->eg;
+	task.settings.core_cnf = f->cnf;
+	task.settings.setup_time = f->setup_time;
+	task.settings.smooth_time = f->smooth_time;
+	task.settings.graph_hash = f->graph_hash;
+	task.bytes = estimate_task_bytes(&task);
+	report(2, "Task '%s' estimated to require %.1f MB\n", task.cnf_name, task.bytes / 1e6);
+	batch_admit(&batch, task.bytes, task.cnf_name);
+	std::lock_guard<std::mutex> guard(batch.lock);
+	batch.active++;
+	batch.ready.push_back(&task);
+	batch.changed.notify_all();
+    }
+    {
+	std::lock_guard<std::mutex> guard(batch.lock);
+	batch.finished = true;
+	batch.changed.notify_all();
+    }
+    for (std::thread &w : workers)
+	w.join();
+    release_shared_egraphs();
+}
+
 int main(int argc, char *argv[]) {
     int c;
     FILE *out_file = NULL;
-    while ((c = getopt(argc, argv, "hIsv:L:p:b:o:")) != -1) {
+    const char *socket_name = NULL;
+    const char *manifest_name = NULL;
+    size_t memory_limit = 0;
+    while ((c = getopt(argc, argv, "hEIsmrxRMv:L:p:b:t:o:S:C:c:K:J:G:")) != -1) {
 	switch(c) {
 	case 'h':
 	    usage(argv[0]);
@@ -388,15 +1391,67 @@ int main(int argc, char *argv[]) {
 		return 1;
 	    }
 	    break;
+	case 'E':
+	    stream = true;
+	    break;
 	case 'I':
 	    instrument = true;
 	    break;
+	case 't':
+	    thread_count = atoi(optarg);
+	    if (thread_count < 1) {
+		printf("Thread count %d not valid\n", thread_count);
+		return 1;
+	    }
+	    break;
+	case 'm':
+	    use_crt = true;
+	    break;
+	case 'r':
+	    race = true;
+	    break;
+	case 'x':
+	    recover = true;
+	    break;
 	case 's':
 	    smooth = true;
 	    break;
 	case 'v':
 	    set_verblevel(atoi(optarg));
 	    break;
+	case 'S':
+	    socket_name = optarg;
+	    break;
+	case 'J':
+	    manifest_name = optarg;
+	    break;
+	case 'G':
+	    memory_limit = (size_t) (atof(optarg) * 1e6);
+	    if (memory_limit == 0) {
+		printf("Memory limit %s not valid\n", optarg);
+		return 1;
+	    }
+	    break;
+	case 'C':
+	    cache_dir = optarg;
+	    break;
+	case 'K':
+	    checkpoint_interval = atof(optarg);
+	    if (checkpoint_interval <= 0) {
+		printf("Checkpoint interval %s not valid\n", optarg);
+		return 1;
+	    }
+	    break;
+	case 'R':
+	    checkpoint_resume = true;
+	    break;
+	case 'M':
+	    share_graph = true;
+	    break;
+	case 'c':
+	    cache_read = strchr(optarg, 'r') != NULL;
+	    cache_write = strchr(optarg, 'w') != NULL;
+	    break;
 	case 'o':
 	    out_file = fopen(optarg, "w");
 	    if (!out_file) {
@@ -412,13 +1467,34 @@ int main(int argc, char *argv[]) {
 	}
     }
     int argi = optind;
+    if (manifest_name) {
+	run_batch(manifest_name, memory_limit);
+	return 0;
+    }
+    if (socket_name) {
+	if (argi + 1 >= argc) {
+	    printf("Server requires at least one NNF and CNF file\n");
+	    usage(argv[0]);
+	    return 1;
+	}
+	run_server(socket_name, argi, argc, argv, out_file);
+	return 0;
+    }
     const char *nnf_name = argv[argi++];
     if (argi >= argc) {
 	printf("Name of input NNF file required\n");
 	usage(argv[0]);
 	return 1;
     }
-    FILE *nnf_file = fopen(nnf_name, "r");
+    if (stream) {
+	if (argi + 1 != argc) {
+	    printf("Streaming evaluation requires a single CNF file\n");
+	    usage(argv[0]);
+	    return 1;
+	}
+	return run_stream(nnf_name, argv[argi]) ? 0 : 1;
+    }
+    FILE *nnf_file = open_input(nnf_name);
     if (!nnf_file)
 	err(true, "Couldn't open NNF file '%s'\n", nnf_name);
 
@@ -428,14 +1504,19 @@ int main(int argc, char *argv[]) {
 	usage(argv[0]);
 	return 1;
     }
-    FILE *cnf_file = fopen(cnf_name, "r");
+    FILE *cnf_file = open_input(cnf_name);
     if (!cnf_file)
 	err(true, "Couldn't open CNF file '%s'\n", cnf_name);
 
     double start = tod();
-    setup(cnf_file, nnf_file, out_file);
-    fclose(cnf_file);
+    setup(nnf_name, cnf_file, nnf_file, out_file);
+    close_input(nnf_file);
+    close_input(cnf_file);
 
+    if (thread_count > 1) {
+	run_parallel(argi, argc, argv);
+	argi = argc;
+    }
     while (argi < argc) {
 	const char *cnf_name = argv[argi++];
 	printf("\n");
@@ -448,6 +1529,7 @@ int main(int argc, char *argv[]) {
 	report_stats();
 	set_logname(NULL);
     }
+    release_shared_egraphs();
     double elapsed = tod() - start;
     printf("%s   Elapsed seconds   : %.3f\n", prefix, elapsed);
     return 0;
@@ -0,0 +1,352 @@
+/*========================================================================
+  Copyright (c) 2024 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "report.h"
+#include "counters.h"
+#include "shared_graph.hh"
+
+// Relies on Linux-specific features: /dev/shm, O_TMPFILE, and MAP_FIXED_NOREPLACE
+#ifdef __linux__
+
+#define SHM_DIR "/dev/shm"
+#define SHM_PREFIX "nnfcount-"
+#define SHM_MAGIC 0x48534757
+#define SHM_VERSION 2
+// Segments are placed at address determined by the key, to reduce collisions among processes
+#define SHM_HINT_BASE 0x100000000000UL
+#define SHM_HINT_SHIFT 38
+#define SHM_HINT_MASK 0x3fUL
+#define MAX_SEGMENTS 64
+#define PATH_LEN 64
+
+// Placed at the start of the segment
+struct Shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    // Address at which segment must be mapped
+    uintptr_t base;
+    size_t length;
+    Egraph *graph;
+    // Space for the graph
+    Egraph_arena arena;
+    // Statistics gathered while building the graph
+    counter_set_t counters;
+    double build_seconds;
+};
+
+struct Shm_segment {
+    int fd;
+    uintptr_t base;
+    size_t length;
+    // Name under which the segment was found or published
+    char path[PATH_LEN];
+};
+
+static Shm_segment segments[MAX_SEGMENTS];
+// Entries are complete before they are counted, so that the signal handler can read them
+static std::atomic<int> segment_count(0);
+static std::mutex segment_lock;
+static bool handlers_installed = false;
+static bool swept = false;
+
+/*******************************************************************************************************************
+Cleanup
+*******************************************************************************************************************/
+
+// Async-signal-safe.  Remove name when no other process holds the segment
+static bool release_segment(Shm_segment &s) {
+    int fd = s.fd;
+    if (fd < 0)
+	return false;
+    s.fd = -1;
+    bool removed = false;
+    // Obtaining exclusive lock indicates that no other process is using the segment
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+	struct stat fsb, psb;
+	// Make sure name still refers to this segment
+	if (fstat(fd, &fsb) == 0 && stat(s.path, &psb) == 0 && fsb.st_ino == psb.st_ino && fsb.st_dev == psb.st_dev)
+	    removed = unlink(s.path) == 0;
+    }
+    close(fd);
+    return removed;
+}
+
+static void release_on_signal(int sig) {
+    int count = segment_count.load();
+    for (int i = 0; i < count; i++)
+	release_segment(segments[i]);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// Called with segment_lock held
+static void install_handlers() {
+    if (handlers_installed)
+	return;
+    handlers_installed = true;
+    atexit(release_shared_egraphs);
+    int sigs[3] = { SIGINT, SIGTERM, SIGHUP };
+    for (int sig : sigs) {
+	struct sigaction old_action;
+	// Keep signals that are being ignored
+	if (sigaction(sig, NULL, &old_action) == 0 && old_action.sa_handler == SIG_IGN)
+	    continue;
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = release_on_signal;
+	sigemptyset(&action.sa_mask);
+	sigaction(sig, &action, NULL);
+    }
+}
+
+// Remove segments left by processes that were killed without a chance to release them
+static void sweep_stale_segments() {
+    DIR *dir = opendir(SHM_DIR);
+    if (!dir)
+	return;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+	if (strncmp(ent->d_name, SHM_PREFIX, strlen(SHM_PREFIX)) != 0)
+	    continue;
+	Shm_segment s;
+	snprintf(s.path, PATH_LEN, "%s/%s", SHM_DIR, ent->d_name);
+	s.fd = open(s.path, O_RDONLY);
+	if (s.fd >= 0 && release_segment(s))
+	    report(2, "Removed stale shared graph '%s'\n", s.path);
+    }
+    closedir(dir);
+}
+
+static void add_segment(int fd, uintptr_t base, size_t length, const char *path) {
+    std::lock_guard<std::mutex> guard(segment_lock);
+    install_handlers();
+    int i = segment_count.load();
+    segments[i].fd = fd;
+    segments[i].base = base;
+    segments[i].length = length;
+    strncpy(segments[i].path, path, PATH_LEN-1);
+    segments[i].path[PATH_LEN-1] = 0;
+    segment_count.store(i+1);
+}
+
+/*******************************************************************************************************************
+Publishing and attaching
+*******************************************************************************************************************/
+
+// Graph depends on NNF file, smoothing, and the data variables of the CNF
+static uint64_t graph_key(const char *nnf_name, std::unordered_set<int> *data_variables, int nvar, bool smooth) {
+    char rpath[PATH_MAX];
+    struct stat sb;
+    if (!realpath(nnf_name, rpath) || stat(rpath, &sb) != 0 || !S_ISREG(sb.st_mode))
+	return 0;
+    std::vector<int> vars(data_variables->begin(), data_variables->end());
+    std::sort(vars.begin(), vars.end());
+    std::string s = std::string(rpath) + "|" + std::to_string((long) sb.st_size)
+	+ "|" + std::to_string((long) sb.st_mtim.tv_sec) + "." + std::to_string((long) sb.st_mtim.tv_nsec)
+	+ "|" + std::to_string(smooth) + "|" + std::to_string(nvar) + "|";
+    for (int v : vars)
+	s += std::to_string(v) + " ";
+    return hash_string(s.c_str());
+}
+
+// Map existing segment.  Caller holds shared lock on fd
+static Egraph *attach_segment(int fd, uint64_t key, const char *path) {
+    Shm_header header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+	|| header.magic != SHM_MAGIC || header.version != SHM_VERSION || header.key != key) {
+	report(1, "Shared graph file '%s' not valid\n", path);
+	return NULL;
+    }
+    void *addr = mmap((void *) header.base, header.length, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+    if (addr == MAP_FAILED) {
+	report(1, "Couldn't map shared graph '%s' at its address.  Using private copy\n", path);
+	return NULL;
+    }
+    if ((uintptr_t) addr != header.base) {
+	// Older kernels treat the address as a hint
+	munmap(addr, header.length);
+	report(1, "Couldn't map shared graph '%s' at its address.  Using private copy\n", path);
+	return NULL;
+    }
+    add_segment(fd, header.base, header.length, path);
+    Shm_header *hp = (Shm_header *) addr;
+    merge_thread_counters(&hp->counters);
+    report(2, "Attached shared graph '%s' (%lu bytes, built in %.3f seconds)\n", path, header.length, hp->build_seconds);
+    return hp->graph;
+}
+
+// Copy graph into new segment and publish it under path.  Returns NULL if this cannot be done
+static Egraph *publish_segment(uint64_t key, const char *path, Egraph *graph, counter_set_t *counters, double build_seconds) {
+    size_t psize = sysconf(_SC_PAGESIZE);
+    size_t length = Egraph_arena::rounded(sizeof(Shm_header)) + graph->arena_bytes();
+    length = (length + psize - 1) & ~(psize - 1);
+    // Unnamed until complete, so that a crash during construction leaves nothing behind
+    int fd = open(SHM_DIR, O_TMPFILE | O_RDWR, 0600);
+    if (fd < 0)
+	return NULL;
+    // Reserve space now, so that a full /dev/shm is detected here rather than by a bus error
+    if (posix_fallocate(fd, 0, length) != 0) {
+	report(1, "Not enough space in %s for shared graph (%lu bytes).  Using private copy\n", SHM_DIR, length);
+	close(fd);
+	return NULL;
+    }
+    void *hint = (void *) (SHM_HINT_BASE + ((key & SHM_HINT_MASK) << SHM_HINT_SHIFT));
+    void *addr = mmap(hint, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+	close(fd);
+	return NULL;
+    }
+    uintptr_t base = (uintptr_t) addr;
+    Shm_header *hp = (Shm_header *) addr;
+    hp->arena.next = base + Egraph_arena::rounded(sizeof(Shm_header));
+    hp->arena.limit = base + length;
+    Egraph *copy = NULL;
+    try {
+	copy = new (hp->arena.allocate(sizeof(Egraph))) Egraph(*graph, &hp->arena);
+    } catch (std::bad_alloc &) {
+	err(false, "Shared graph space exhausted\n");
+	munmap(addr, length);
+	close(fd);
+	return NULL;
+    }
+    // Graph is immutable
+    hp->arena.limit = hp->arena.next;
+    hp->magic = SHM_MAGIC;
+    hp->version = SHM_VERSION;
+    hp->key = key;
+    hp->base = base;
+    hp->length = length;
+    hp->graph = copy;
+    hp->counters = *counters;
+    hp->build_seconds = build_seconds;
+    mprotect(addr, length, PROT_READ);
+
+    flock(fd, LOCK_SH);
+    add_segment(fd, base, length, path);
+    char fdpath[PATH_LEN];
+    snprintf(fdpath, PATH_LEN, "/proc/self/fd/%d", fd);
+    if (linkat(AT_FDCWD, fdpath, AT_FDCWD, path, AT_SYMLINK_FOLLOW) == 0)
+	report(2, "Published shared graph '%s' (%lu bytes)\n", path, length);
+    else
+	// Another process published the same graph first
+	report(2, "Couldn't publish shared graph '%s'\n", path);
+    return copy;
+}
+
+Egraph *share_egraph(const char *nnf_name, std::unordered_set<int> *data_variables, int nvar, bool smooth,
+		     Egraph *(*build)(std::unordered_set<int> *data_variables)) {
+    uint64_t key = 0;
+    char path[PATH_LEN];
+    if (segment_count.load() < MAX_SEGMENTS)
+	key = graph_key(nnf_name, data_variables, nvar, smooth);
+    if (key != 0) {
+	{
+	    std::lock_guard<std::mutex> guard(segment_lock);
+	    if (!swept) {
+		swept = true;
+		sweep_stale_segments();
+	    }
+	}
+	snprintf(path, PATH_LEN, "%s/%s%016lx", SHM_DIR, SHM_PREFIX, (unsigned long) key);
+	int fd = open(path, O_RDONLY);
+	if (fd >= 0) {
+	    flock(fd, LOCK_SH);
+	    Egraph *graph = attach_segment(fd, key, path);
+	    if (graph)
+		return graph;
+	    flock(fd, LOCK_UN);
+	    close(fd);
+	    // Published copy exists but can't be used here
+	    key = 0;
+	}
+    }
+    double start = tod();
+    counter_set_t build_counters;
+    init_counter_set(&build_counters);
+    counter_set_t *caller_counters = get_thread_counters();
+    set_thread_counters(&build_counters);
+    Egraph *graph = build(data_variables);
+    set_thread_counters(caller_counters);
+    merge_thread_counters(&build_counters);
+    if (key == 0)
+	return graph;
+    Egraph *copy = publish_segment(key, path, graph, &build_counters, tod() - start);
+    if (!copy)
+	return graph;
+    delete graph;
+    return copy;
+}
+
+bool shared_egraph(Egraph *graph) {
+    uintptr_t a = (uintptr_t) graph;
+    int count = segment_count.load();
+    for (int i = 0; i < count; i++)
+	if (a >= segments[i].base && a < segments[i].base + segments[i].length)
+	    return true;
+    return false;
+}
+
+void release_shared_egraphs() {
+    std::lock_guard<std::mutex> guard(segment_lock);
+    int count = segment_count.load();
+    for (int i = 0; i < count; i++) {
+	if (release_segment(segments[i]))
+	    report(2, "Removed shared graph '%s'\n", segments[i].path);
+    }
+}
+
+#else
+
+Egraph *share_egraph(const char *nnf_name, std::unordered_set<int> *data_variables, int nvar, bool smooth,
+		     Egraph *(*build)(std::unordered_set<int> *data_variables)) {
+    return build(data_variables);
+}
+
+bool shared_egraph(Egraph *graph) {
+    return false;
+}
+
+void release_shared_egraphs() {}
+
+#endif
@@ -0,0 +1,45 @@
+/*========================================================================
+  Copyright (c) 2024 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+// Share parsed egraph among concurrent nnfcount processes.
+// Only supported on Linux.
+// A finished graph is copied into a file in /dev/shm that every process maps at the same address,
+// so that the pointers within its containers are valid everywhere.
+// Processes hold shared locks on the file.  The last one to release it removes the file.
+
+#pragma once
+
+#include "egraph.hh"
+
+// Find shared graph for NNF file, or call build to construct it and then publish it.
+// Returns private graph when sharing is not possible
+Egraph *share_egraph(const char *nnf_name, std::unordered_set<int> *data_variables, int nvar, bool smooth,
+		     Egraph *(*build)(std::unordered_set<int> *data_variables));
+
+// Is graph held in shared memory?
+bool shared_egraph(Egraph *graph);
+
+// Release all shared graphs held by this process.  Also done at exit and on termination signals
+void release_shared_egraphs();
@@ -0,0 +1,240 @@
+/*========================================================================
+  Copyright (c) 2024 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+// Implementation of libwmc interface
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "cnf_info.hh"
+#include "egraph.hh"
+#include "report.h"
+#include "decompress.h"
+#include "analysis.h"
+#include "wmc.h"
+
+struct wmc_graph {
+    Cnf *cnf;
+    Egraph *eg;
+    // Reused across evaluations
+    Evaluator_combo *combo;
+    double combo_target_precision;
+};
+
+struct wmc_weights {
+    Egraph_weights *weights;
+};
+
+static wmc_graph_t *load_graph(FILE *nnf_file, FILE *cnf_file, bool smooth) {
+    wmc_graph_t *graph = new wmc_graph_t;
+    graph->cnf = new Cnf();
+    if (!graph->cnf->import_file(cnf_file, true, false)) {
+	delete graph->cnf;
+	delete graph;
+	return NULL;
+    }
+    graph->eg = new Egraph(graph->cnf->data_variables, graph->cnf->variable_count());
+    graph->eg->read_nnf(nnf_file);
+    if (smooth)
+	graph->eg->smooth();
+    graph->combo = NULL;
+    graph->combo_target_precision = 0;
+    return graph;
+}
+
+wmc_graph_t *wmc_load_graph(const char *nnf_name, const char *cnf_name, int smooth) {
+    FILE *nnf_file = open_input(nnf_name);
+    if (!nnf_file) {
+	err(false, "Couldn't open NNF file '%s'\n", nnf_name);
+	return NULL;
+    }
+    FILE *cnf_file = open_input(cnf_name);
+    if (!cnf_file) {
+	err(false, "Couldn't open CNF file '%s'\n", cnf_name);
+	close_input(nnf_file);
+	return NULL;
+    }
+    wmc_graph_t *graph = load_graph(nnf_file, cnf_file, smooth);
+    close_input(nnf_file);
+    close_input(cnf_file);
+    return graph;
+}
+
+wmc_graph_t *wmc_load_graph_buffer(const char *nnf_text, size_t nnf_length,
+				   const char *cnf_text, size_t cnf_length, int smooth) {
+    FILE *nnf_file = fmemopen((void *) nnf_text, nnf_length, "r");
+    FILE *cnf_file = fmemopen((void *) cnf_text, cnf_length, "r");
+    wmc_graph_t *graph = NULL;
+    if (nnf_file && cnf_file)
+	graph = load_graph(nnf_file, cnf_file, smooth);
+    else
+	err(false, "Couldn't read from buffers\n");
+    if (nnf_file)
+	fclose(nnf_file);
+    if (cnf_file)
+	fclose(cnf_file);
+    return graph;
+}
+
+void wmc_free_graph(wmc_graph_t *graph) {
+    if (!graph)
+	return;
+    delete graph->combo;
+    delete graph->eg;
+    delete graph->cnf->data_variables;
+    delete graph->cnf;
+    delete graph;
+}
+
+void wmc_graph_stats(wmc_graph_t *graph, wmc_graph_stats_t *stats) {
+    stats->variable_count = graph->eg->nvar;
+    stats->data_variable_count = graph->eg->data_variables.size();
+    stats->smooth_variable_count = graph->eg->smooth_variable_count;
+    stats->operation_count = graph->eg->operations.size();
+    stats->edge_count = graph->eg->edges.size();
+}
+
+wmc_weights_t *wmc_create_weights(wmc_graph_t *graph, int count, const int *literals, const char *const *weights) {
+    std::unordered_map<int,const char*> literal_weights;
+    for (int i = 0; i < count; i++)
+	literal_weights[literals[i]] = weights[i];
+    Egraph_weights *eweights = graph->eg->prepare_weights(count > 0 ? &literal_weights : NULL);
+    if (!eweights)
+	return NULL;
+    wmc_weights_t *result = new wmc_weights_t;
+    result->weights = eweights;
+    return result;
+}
+
+wmc_weights_t *wmc_create_weights_double(wmc_graph_t *graph, int count, const int *literals, const double *weights) {
+    std::vector<char *> sweights(count);
+    for (int i = 0; i < count; i++) {
+	char buf[40];
+	snprintf(buf, 40, "%.17g", weights[i]);
+	sweights[i] = strdup(buf);
+    }
+    wmc_weights_t *result = wmc_create_weights(graph, count, literals, sweights.data());
+    for (char *s : sweights)
+	free(s);
+    return result;
+}
+
+void wmc_free_weights(wmc_weights_t *weights) {
+    if (!weights)
+	return;
+    delete weights->weights;
+    delete weights;
+}
+
+static const char *wmc_method_name[6] = { "COMBO", "DBL", "ERD", "MPF", "MPFI", "MPQ" };
+
+int wmc_evaluate(wmc_graph_t *graph, wmc_weights_t *weights, wmc_method_t method,
+		 double target_precision, wmc_result_t *result) {
+    Egraph *eg = graph->eg;
+    Egraph_weights *ew = weights->weights;
+    int bits = required_bit_precision(target_precision, eg->nvar, 5, false);
+    mpf_class count(0.0, bits);
+    double start_time = tod();
+    result->method = wmc_method_name[method];
+    result->guaranteed_precision = 0.0;
+    result->bit_precision = 0;
+    result->max_bytes = 0;
+    switch (method) {
+    case WMC_COMBO:
+	if (graph->combo && graph->combo_target_precision == target_precision)
+	    graph->combo->rebind(ew, 0);
+	else {
+	    delete graph->combo;
+	    graph->combo = new Evaluator_combo(eg, ew, target_precision, 0, false);
+	    graph->combo_target_precision = target_precision;
+	}
+	graph->combo->evaluate(count, false);
+	result->method = graph->combo->method();
+	result->guaranteed_precision = graph->combo->guaranteed_precision;
+	result->bit_precision = graph->combo->used_bit_precision();
+	result->max_bytes = graph->combo->max_bytes;
+	break;
+    case WMC_DOUBLE:
+	{
+	    Evaluator_double ev(eg, ew);
+	    count = ev.evaluate();
+	    result->bit_precision = 53;
+	}
+	break;
+    case WMC_ERD:
+	{
+	    Evaluator_erd ev(eg, ew);
+	    ev.evaluate(count);
+	    result->bit_precision = 64;
+	}
+	break;
+    case WMC_MPF:
+	{
+	    Evaluator_mpf ev(eg, ew, bits);
+	    ev.evaluate(count);
+	    result->bit_precision = bits;
+	}
+	break;
+    case WMC_MPFI:
+	{
+	    Evaluator_mpfi ev(eg, ew, false, bits);
+	    mpfi_t icount;
+	    mpfi_init2(icount, bits);
+	    ev.evaluate(icount);
+	    result->guaranteed_precision = digit_precision_mpfi(icount);
+	    mpfr_t mid;
+	    mpfr_init2(mid, bits);
+	    mpfi_mid(mid, icount);
+	    mpfr_get_f(count.get_mpf_t(), mid, MPFR_RNDN);
+	    mpfr_clear(mid);
+	    mpfi_clear(icount);
+	    result->bit_precision = bits;
+	}
+	break;
+    case WMC_MPQ:
+	{
+	    Evaluator_mpq ev(eg, ew);
+	    mpq_class qcount;
+	    ev.evaluate(qcount);
+	    mpf_set_q(count.get_mpf_t(), qcount.get_mpq_t());
+	    result->guaranteed_precision = MAX_DIGIT_PRECISION;
+	    result->max_bytes = ev.max_bytes;
+	}
+	break;
+    default:
+	err(false, "Invalid evaluation method %d\n", (int) method);
+	return -1;
+    }
+    result->seconds = tod() - start_time;
+    result->count = count.get_d();
+    result->count_string = (char *) mpf_string(count.get_mpf_t(), (int) target_precision);
+    return 0;
+}
+
+void wmc_clear_result(wmc_result_t *result) {
+    free(result->count_string);
+    result->count_string = NULL;
+}
@@ -0,0 +1,103 @@
+/*========================================================================
+  Copyright (c) 2024 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+// libwmc: In-process interface to weighted model counting
+// Load a d-DNNF graph once and then evaluate it for any number of weight sets
+
+#pragma once
+
+#include <stddef.h>
+
+/* Allow this headerfile to define C++ constructs if requested */
+#ifdef __cplusplus
+#define CPLUSPLUS
+#endif
+
+#ifdef CPLUSPLUS
+extern "C" {
+#endif
+
+typedef struct wmc_graph wmc_graph_t;
+typedef struct wmc_weights wmc_weights_t;
+
+typedef enum {
+    // Choose among methods to achieve target precision, as does nnfcount
+    WMC_COMBO,
+    // Single methods.  Guaranteed precision reported only for MPQ
+    WMC_DOUBLE, WMC_ERD, WMC_MPF, WMC_MPFI, WMC_MPQ
+} wmc_method_t;
+
+typedef struct {
+    // Count, rounded to double
+    double count;
+    // Count as decimal string with target number of digits.  Owned by result
+    char *count_string;
+    // Method that produced the count
+    const char *method;
+    // Guaranteed decimal digits of precision.  0 if not known
+    double guaranteed_precision;
+    // Bit precision of floating-point evaluation.  0 if not used
+    int bit_precision;
+    double seconds;
+    size_t max_bytes;
+} wmc_result_t;
+
+typedef struct {
+    int variable_count;
+    int data_variable_count;
+    int smooth_variable_count;
+    int operation_count;
+    int edge_count;
+} wmc_graph_stats_t;
+
+// Load d-DNNF from NNF file, with data variables declared in CNF file.
+// Return NULL if files can't be read
+wmc_graph_t *wmc_load_graph(const char *nnf_name, const char *cnf_name, int smooth);
+// Same, with file contents given as buffers
+wmc_graph_t *wmc_load_graph_buffer(const char *nnf_text, size_t nnf_length,
+				   const char *cnf_text, size_t cnf_length, int smooth);
+void wmc_free_graph(wmc_graph_t *graph);
+void wmc_graph_stats(wmc_graph_t *graph, wmc_graph_stats_t *stats);
+
+// Create weight set.  Weight for literal literals[i] is given by weights[i]
+// as a decimal string (e.g., "0.25" or "1e-3").  Literals without weights get
+// 1 - weight of their complement, or 1 if neither is given.  count == 0 gives unweighted counting.
+// Return NULL if a weight can't be parsed
+wmc_weights_t *wmc_create_weights(wmc_graph_t *graph, int count, const int *literals, const char *const *weights);
+// Same, with weights given as doubles.  Converted with 17 significant digits
+wmc_weights_t *wmc_create_weights_double(wmc_graph_t *graph, int count, const int *literals, const double *weights);
+void wmc_free_weights(wmc_weights_t *weights);
+
+// Evaluate graph with weights, aiming for target_precision decimal digits.
+// Return 0 if successful.
+// A graph can only be evaluated by one thread at a time.  Different graphs can be evaluated concurrently
+int wmc_evaluate(wmc_graph_t *graph, wmc_weights_t *weights, wmc_method_t method,
+		 double target_precision, wmc_result_t *result);
+// Free storage held by result
+void wmc_clear_result(wmc_result_t *result);
+
+#ifdef CPLUSPLUS
+}
+#endif
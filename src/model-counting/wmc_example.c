@@ -0,0 +1,84 @@
+/*========================================================================
+  Copyright (c) 2024 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+// Example use of libwmc.
+// Load formula once and then count with several weight sets
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wmc.h"
+
+static void show(const char *label, wmc_result_t *result) {
+    printf("%s: count = %s (method %s, guaranteed precision %.3f, %.3f seconds)\n",
+	   label, result->count_string, result->method, result->guaranteed_precision, result->seconds);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+	printf("Usage: %s FORMULA.nnf FORMULA.cnf\n", argv[0]);
+	return 1;
+    }
+    wmc_graph_t *graph = wmc_load_graph(argv[1], argv[2], 0);
+    if (!graph)
+	return 1;
+    wmc_graph_stats_t stats;
+    wmc_graph_stats(graph, &stats);
+    printf("Loaded graph with %d variables, %d operations, %d edges\n",
+	   stats.variable_count, stats.operation_count, stats.edge_count);
+
+    wmc_result_t result;
+    wmc_weights_t *weights = wmc_create_weights(graph, 0, NULL, NULL);
+    if (wmc_evaluate(graph, weights, WMC_COMBO, 30, &result) == 0) {
+	show("Unweighted", &result);
+	wmc_clear_result(&result);
+    }
+    wmc_free_weights(weights);
+
+    // Give variable v weight 1/(v+1)
+    int n = stats.variable_count;
+    int *literals = malloc(n * sizeof(int));
+    double *values = malloc(n * sizeof(double));
+    for (int v = 1; v <= n; v++) {
+	literals[v-1] = v;
+	values[v-1] = 1.0 / (v+1);
+    }
+    weights = wmc_create_weights_double(graph, n, literals, values);
+    if (weights) {
+	if (wmc_evaluate(graph, weights, WMC_COMBO, 30, &result) == 0) {
+	    show("Weighted", &result);
+	    wmc_clear_result(&result);
+	}
+	if (wmc_evaluate(graph, weights, WMC_DOUBLE, 30, &result) == 0) {
+	    show("Weighted", &result);
+	    wmc_clear_result(&result);
+	}
+	wmc_free_weights(weights);
+    }
+    free(literals);
+    free(values);
+    wmc_free_graph(graph);
+    return 0;
+}
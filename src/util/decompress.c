@@ -0,0 +1,285 @@
+/*========================================================================
+  Copyright (c) 2024 Randal E. Bryant, Carnegie Mellon University
+  
+  Permission is hereby granted, free of
+  charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the
+  Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom
+  the Software is furnished to do so, subject to the following
+  conditions:
+  
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+  
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+========================================================================*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "report.h"
+#include "decompress.h"
+
+// Size of decompression buffers
+#define CHUNK (1 << 16)
+// Requested capacity of pipe between decompression thread and reader
+#define PIPE_SIZE (1 << 20)
+
+typedef enum { FORMAT_PLAIN, FORMAT_GZIP, FORMAT_ZSTD } format_t;
+
+typedef struct DSTATE {
+    FILE *reader;
+    const char *fname;
+    format_t format;
+    int in_fd;
+    int out_fd;
+    // Bytes read while detecting format
+    unsigned char header[4];
+    int header_length;
+    volatile bool cancel;
+    pthread_t thread;
+    struct DSTATE *next;
+} dstate_t;
+
+// Files with active decompression threads
+static dstate_t *active_list = NULL;
+static pthread_mutex_t active_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Write all bytes to pipe.  Return false if reader has gone away
+static bool write_all(dstate_t *ds, const unsigned char *buf, size_t len) {
+    while (len > 0 && !ds->cancel) {
+	ssize_t n = write(ds->out_fd, buf, len);
+	if (n < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	buf += n;
+	len -= n;
+    }
+    return !ds->cancel;
+}
+
+// Fill buffer with input, starting with saved header bytes.  Return number of bytes read
+static ssize_t read_input(dstate_t *ds, unsigned char *buf, size_t len) {
+    if (ds->header_length > 0) {
+	int n = ds->header_length;
+	memcpy(buf, ds->header, n);
+	ds->header_length = 0;
+	return n;
+    }
+    ssize_t n;
+    while ((n = read(ds->in_fd, buf, len)) < 0 && errno == EINTR)
+	;
+    return n;
+}
+
+static void copy_plain(dstate_t *ds, unsigned char *in) {
+    ssize_t n;
+    while ((n = read_input(ds, in, CHUNK)) > 0)
+	if (!write_all(ds, in, n))
+	    return;
+}
+
+static void inflate_gzip(dstate_t *ds, unsigned char *in, unsigned char *out) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    // Accept gzip or zlib header
+    if (inflateInit2(&strm, 15 + 32) != Z_OK)
+	err(true, "Couldn't initialize decompression of '%s'\n", ds->fname);
+    int ret = Z_OK;
+    ssize_t n;
+    while ((n = read_input(ds, in, CHUNK)) > 0) {
+	strm.next_in = in;
+	strm.avail_in = n;
+	while (strm.avail_in > 0) {
+	    // Concatenated gzip members
+	    if (ret == Z_STREAM_END)
+		inflateReset(&strm);
+	    strm.next_out = out;
+	    strm.avail_out = CHUNK;
+	    ret = inflate(&strm, Z_NO_FLUSH);
+	    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+		err(true, "Error decompressing '%s'\n", ds->fname);
+	    if (!write_all(ds, out, CHUNK - strm.avail_out)) {
+		inflateEnd(&strm);
+		return;
+	    }
+	}
+    }
+    // Flush any remaining output
+    while (ret == Z_OK) {
+	strm.next_out = out;
+	strm.avail_out = CHUNK;
+	ret = inflate(&strm, Z_FINISH);
+	if (!write_all(ds, out, CHUNK - strm.avail_out))
+	    break;
+	if (strm.avail_out > 0)
+	    break;
+    }
+    if (ret != Z_STREAM_END && !ds->cancel)
+	err(true, "Compressed file '%s' is truncated\n", ds->fname);
+    inflateEnd(&strm);
+}
+
+#ifdef HAVE_ZSTD
+static void decompress_zstd(dstate_t *ds, unsigned char *in, unsigned char *out) {
+    ZSTD_DStream *zs = ZSTD_createDStream();
+    if (!zs)
+	err(true, "Couldn't initialize decompression of '%s'\n", ds->fname);
+    ZSTD_initDStream(zs);
+    size_t ret = 0;
+    ssize_t n;
+    while ((n = read_input(ds, in, CHUNK)) > 0) {
+	ZSTD_inBuffer input = { in, (size_t) n, 0 };
+	while (input.pos < input.size) {
+	    ZSTD_outBuffer output = { out, CHUNK, 0 };
+	    ret = ZSTD_decompressStream(zs, &output, &input);
+	    if (ZSTD_isError(ret))
+		err(true, "Error decompressing '%s': %s\n", ds->fname, ZSTD_getErrorName(ret));
+	    if (!write_all(ds, out, output.pos)) {
+		ZSTD_freeDStream(zs);
+		return;
+	    }
+	}
+    }
+    if (ret != 0 && !ds->cancel)
+	err(true, "Compressed file '%s' is truncated\n", ds->fname);
+    ZSTD_freeDStream(zs);
+}
+#endif
+
+static void *decompress_thread(void *vds) {
+    dstate_t *ds = (dstate_t *) vds;
+    unsigned char *in = malloc(CHUNK);
+    unsigned char *out = malloc(CHUNK);
+    switch (ds->format) {
+    case FORMAT_GZIP:
+	inflate_gzip(ds, in, out);
+	break;
+#ifdef HAVE_ZSTD
+    case FORMAT_ZSTD:
+	decompress_zstd(ds, in, out);
+	break;
+#endif
+    default:
+	copy_plain(ds, in);
+    }
+    free(in);
+    free(out);
+    // Reader sees end of file
+    close(ds->out_fd);
+    return NULL;
+}
+
+static format_t detect_format(const unsigned char *header, int len) {
+    if (len >= 2 && header[0] == 0x1f && header[1] == 0x8b)
+	return FORMAT_GZIP;
+    if (len >= 4 && header[0] == 0x28 && header[1] == 0xb5 && header[2] == 0x2f && header[3] == 0xfd)
+	return FORMAT_ZSTD;
+    return FORMAT_PLAIN;
+}
+
+FILE *open_input(const char *fname) {
+    bool use_stdin = strcmp(fname, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(fname, O_RDONLY);
+    if (fd < 0)
+	return NULL;
+    unsigned char header[4];
+    int len = 0;
+    ssize_t n;
+    while (len < 4 && ((n = read(fd, header + len, 4 - len)) > 0 || (n < 0 && errno == EINTR)))
+	if (n > 0)
+	    len += n;
+    format_t format = detect_format(header, len);
+#ifndef HAVE_ZSTD
+    if (format == FORMAT_ZSTD) {
+	err(false, "File '%s' is zstd compressed, but zstd support not compiled in\n", fname);
+	if (!use_stdin)
+	    close(fd);
+	return NULL;
+    }
+#endif
+    if (format == FORMAT_PLAIN && lseek(fd, -len, SEEK_CUR) >= 0) {
+	// Read directly
+	if (use_stdin)
+	    return stdin;
+	return fdopen(fd, "r");
+    }
+
+    int pfd[2];
+    if (pipe(pfd) < 0) {
+	if (!use_stdin)
+	    close(fd);
+	return NULL;
+    }
+#ifdef F_SETPIPE_SZ
+    fcntl(pfd[1], F_SETPIPE_SZ, PIPE_SIZE);
+#endif
+    dstate_t *ds = malloc(sizeof(dstate_t));
+    ds->fname = archive_string(fname);
+    ds->format = format;
+    ds->in_fd = fd;
+    ds->out_fd = pfd[1];
+    memcpy(ds->header, header, len);
+    ds->header_length = len;
+    ds->cancel = false;
+    ds->reader = fdopen(pfd[0], "r");
+    setvbuf(ds->reader, NULL, _IOFBF, CHUNK);
+    if (pthread_create(&ds->thread, NULL, decompress_thread, ds) != 0)
+	err(true, "Couldn't create decompression thread for '%s'\n", fname);
+    pthread_mutex_lock(&active_lock);
+    ds->next = active_list;
+    active_list = ds;
+    pthread_mutex_unlock(&active_lock);
+    return ds->reader;
+}
+
+void close_input(FILE *infile) {
+    pthread_mutex_lock(&active_lock);
+    dstate_t **dp = &active_list;
+    while (*dp && (*dp)->reader != infile)
+	dp = &(*dp)->next;
+    dstate_t *ds = *dp;
+    if (ds)
+	*dp = ds->next;
+    pthread_mutex_unlock(&active_lock);
+    if (!ds) {
+	if (infile != stdin)
+	    fclose(infile);
+	return;
+    }
+    // Stop decompression, and drain pipe so that writer can't block
+    ds->cancel = true;
+    char buf[CHUNK];
+    while (fread(buf, 1, CHUNK, infile) > 0)
+	;
+    pthread_join(ds->thread, NULL);
+    fclose(infile);
+    if (ds->in_fd != STDIN_FILENO)
+	close(ds->in_fd);
+    free((void *) ds->fname);
+    free(ds);
+}
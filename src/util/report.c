@@ -29,6 +29,7 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <sys/param.h>
+#include <pthread.h>
 
 #include "report.h"
 //#include "path.h"
@@ -44,6 +45,19 @@ static panic_function_t panic_function = NULL;
 
 static const char *logfile_name = NULL;
 
+// Log file for calling thread, overriding logfile_name
+static __thread const char *thread_logfile_name = NULL;
+
+// Destination for all output of calling thread, overriding stdout, errfile, and verbfile
+static __thread FILE *thread_outfile = NULL;
+
+// Serializes output, so that messages from different threads don't interleave
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *current_logname() {
+    return thread_logfile_name ? thread_logfile_name : logfile_name;
+}
+
 static const char *datafile_name = "datafile.csv";
 
 static double start_time = 0.0;
@@ -98,18 +112,37 @@ const char *find_program_path(const char *progname) {
 //  Logging information
 // Establish a log file
 void set_logname(const char *fname) {
-    if (fname == NULL) {
+    pthread_mutex_lock(&report_lock);
+    if (fname == NULL)
 	logfile_name = NULL;
+    else {
+	logfile_name = archive_string(fname);
+	// Clear out whatever was there
+	FILE *logfile = fopen(logfile_name, "w");
+	if (logfile)
+	    fclose(logfile);
+    }
+    pthread_mutex_unlock(&report_lock);
+}
+
+void set_thread_logname(const char *fname) {
+    if (fname == NULL) {
+	thread_logfile_name = NULL;
 	return;
     }
-    logfile_name = archive_string(fname);
-    // Clear out whatever was there
-    FILE *logfile = fopen(logfile_name, "w");
+    thread_logfile_name = archive_string(fname);
+    pthread_mutex_lock(&report_lock);
+    FILE *logfile = fopen(thread_logfile_name, "w");
     if (logfile)
 	fclose(logfile);
+    pthread_mutex_unlock(&report_lock);
 }
 
 
+void set_thread_output(FILE *out) {
+    thread_outfile = out;
+}
+
 void set_verblevel(int level) {
     verblevel = level;
 }
@@ -122,16 +155,19 @@ void err(bool fatal, const char *fmt, ...) {
     if (!errfile)
 	errfile = stdout;
     va_list ap;
+    pthread_mutex_lock(&report_lock);
+    const char *lname = current_logname();
+    FILE *out = thread_outfile ? thread_outfile : errfile;
     va_start(ap, fmt);
     if (fatal)
-	fprintf(errfile, "c ERROR: ");
+	fprintf(out, "c ERROR: ");
     else
-	fprintf(errfile, "c WARNING: ");
-    vfprintf(errfile, fmt, ap);
-    fflush(errfile);
+	fprintf(out, "c WARNING: ");
+    vfprintf(out, fmt, ap);
+    fflush(out);
     va_end(ap);
-    if (logfile_name) {
-	FILE *logfile = fopen(logfile_name, "a");
+    if (lname) {
+	FILE *logfile = fopen(lname, "a");
 	if (logfile) {
 	    va_start(ap, fmt);
 	    if (fatal)
@@ -143,6 +179,15 @@ void err(bool fatal, const char *fmt, ...) {
 	    fclose(logfile);
 	}
     }
+    if (fatal && thread_outfile) {
+	// Thread's output may never be printed
+	fprintf(errfile, "c ERROR: ");
+	va_start(ap, fmt);
+	vfprintf(errfile, fmt, ap);
+	va_end(ap);
+	fflush(errfile);
+    }
+    pthread_mutex_unlock(&report_lock);
     if (fatal) {
 	if (panic_function)
 	    panic_function();
@@ -155,13 +200,16 @@ void report(int level, const char *fmt, ...) {
 	verbfile = stdout;
     va_list ap;
     if (level <= verblevel) {
-	fprintf(verbfile, "c ");
+	pthread_mutex_lock(&report_lock);
+	const char *lname = current_logname();
+	FILE *out = thread_outfile ? thread_outfile : verbfile;
+	fprintf(out, "c ");
 	va_start(ap, fmt);
-	vfprintf(verbfile, fmt, ap);
-	fflush(verbfile);
+	vfprintf(out, fmt, ap);
+	fflush(out);
 	va_end(ap);
-	if (logfile_name) {
-	    FILE *logfile = fopen(logfile_name, "a");
+	if (lname) {
+	    FILE *logfile = fopen(lname, "a");
 	    if (logfile) {
 		fprintf(logfile, "c ");
 		va_start(ap, fmt);
@@ -170,17 +218,21 @@ void report(int level, const char *fmt, ...) {
 		fclose(logfile);
 	    }
 	}
+	pthread_mutex_unlock(&report_lock);
     }
 }
 
 void lprintf(const char *fmt, ...) {
     va_list ap;
+    pthread_mutex_lock(&report_lock);
+    const char *lname = current_logname();
+    FILE *out = thread_outfile ? thread_outfile : stdout;
     va_start(ap, fmt);
-    vfprintf(stdout, fmt, ap);
-    fflush(stdout);
+    vfprintf(out, fmt, ap);
+    fflush(out);
     va_end(ap);
-    if (logfile_name) {
-	FILE *logfile = fopen(logfile_name, "a");
+    if (lname) {
+	FILE *logfile = fopen(lname, "a");
 	if (logfile) {
 	    va_start(ap, fmt);
 	    vfprintf(logfile, fmt, ap);
@@ -188,19 +240,22 @@ void lprintf(const char *fmt, ...) {
 	    fclose(logfile);
 	}
     }
+    pthread_mutex_unlock(&report_lock);
 }
 
 void log_data(const char *fmt, ...) {
     va_list ap;
     if (datafile_name == NULL)
 	return;
+    pthread_mutex_lock(&report_lock);
     FILE *datafile = fopen(datafile_name, "a");
-    if (!datafile)
-	return;
-    va_start(ap, fmt);
-    vfprintf(datafile, fmt, ap);
-    va_end(ap);
-    fclose(datafile);
+    if (datafile) {
+	va_start(ap, fmt);
+	vfprintf(datafile, fmt, ap);
+	va_end(ap);
+	fclose(datafile);
+    }
+    pthread_mutex_unlock(&report_lock);
 }
 
 
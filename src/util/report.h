@@ -78,6 +78,13 @@ extern FILE *verbfile;
 // Record all information in separate file.  Opens and closes with each write
 // so that will be preserved even if process terminates due to segfault or kill
 void set_logname(const char *fname);
+// Record information for calling thread in separate file, overriding set_logname.  NULL reverts
+void set_thread_logname(const char *fname);
+
+// Send all output of calling thread to out, rather than stdout.  NULL reverts
+void set_thread_output(FILE *out);
+
+// Output functions are thread safe.  Each message is written without interleaving
 
 /* Report Errors */
 void err(bool fatal, const char *fmt, ...);
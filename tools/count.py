@@ -33,7 +33,7 @@ import parallel
 p = parallel.Printer()
 
 def usage(name):
-    p.print("Usage: %s [-f] [-h] [-s] [-I] [-L LEVEL] [-p PREC] [-b BPREC] [-D SPATH] [-N THRDS] P1.NNF P2.NNF ... " % name)
+    p.print("Usage: %s [-f] [-h] [-s] [-I] [-L LEVEL] [-p PREC] [-b BPREC] [-D SPATH] [-N THRDS] [-M] P1.NNF P2.NNF ... " % name)
     p.print("  -h       Print this message")
     p.print("  -f       Force regeneration of all files")
     p.print("  -s       Use smoothing")
@@ -48,6 +48,7 @@ def usage(name):
     p.print("  -b BPREC Fix bit precision (should be multiple of 64)")
     p.print("  -D SPATH Directory for source NNF files")
     p.print("  -N THRDS Run N threads concurrently")
+    p.print("  -M       Share parsed graphs among nnfcount processes")
     p.print("  -t TIME  Limit time for each of the programs")
 
 # Defaults
@@ -61,6 +62,8 @@ instrument = False
 targetPrecision = None
 bitPrecision = None
 detailLevel = None
+# Share graphs through shared memory?
+shareGraph = False
 
 # Pathnames
 def genProgramPath(progName, subdirectory = "bin"):
@@ -133,6 +136,8 @@ def runJob(nnfPath):
             cmd += ['-b', str(bitPrecision)]
         if detailLevel is not None:
             cmd += ['-L', str(detailLevel)]
+        if shareGraph:
+            cmd += ['-M']
         cmd += [nnfPath] + cnfNames
         ok = runCommand(cmd)
         if not ok:
@@ -170,8 +175,9 @@ def run(name, args):
     global targetPrecision
     global bitPrecision
     global detailLevel
+    global shareGraph
     home = None
-    optList, args = getopt.getopt(args, "hfsIp:b:L:D:N:")
+    optList, args = getopt.getopt(args, "hfsIMp:b:L:D:N:")
     for (opt, val) in optList:
         if opt == '-h':
             usage(name)
@@ -192,6 +198,8 @@ def run(name, args):
             home = val
         elif opt == '-N':
             threadCount = int(val)
+        elif opt == '-M':
+            shareGraph = True
         else:
             p.print("Unknown option '%s'" % opt)
             usage(name)